@@ -0,0 +1,431 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host microbenchmarks of the advertising payload path.
+//
+// BluetoothLowEnergyEncapsulation is compiled unchanged against the mocks
+// in mock/, which stand in for BLE, ble::Gap and AdvertisingDataBuilder.
+// The encapsulation is started as it is on target, except that BLE::init()
+// completes at once, and each benchmark then calls one step of the
+// payload path in a loop. For every benchmark this reports the time per
+// call, the heap allocations per call and how many writes per call would
+// have gone to the controller, i.e. advertising payloads, scan responses
+// and GATT values.
+//
+// By default the mock controller only does legacy advertising; with
+// --extended it supports extended and periodic advertising too, which
+// only makes a difference to a build with app.extended-advertising.
+//
+// The payload path is meant never to allocate. A benchmark that finds it
+// does fails the run, so the harness doubles as a check.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <chrono>
+
+#include "BluetoothLowEnergyEncapsulation.h"
+
+// Every allocation made through operator new, which covers mbed::Callback
+// and everything else the encapsulation could allocate with on the host.
+static size_t gs_Allocations = 0;
+
+void * operator new(size_t size)
+{
+    ++gs_Allocations;
+
+    void *memory = malloc(size ? size : 1);
+
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void * operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+// Keeps the compiler from discarding a result that is not otherwise used.
+template <typename T>
+static inline void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class BluetoothLowEnergyEncapsulationBenchmark
+{
+public:
+    BluetoothLowEnergyEncapsulationBenchmark(unsigned long iterations, bool extendedAdvertising)
+        : m_Ble()
+        , m_EventQueue()
+        , m_Encapsulation(m_Ble, m_EventQueue)
+        , m_Iterations(iterations)
+        , m_Failed(false)
+    {
+        if (extendedAdvertising)
+        {
+            m_Ble.gap().m_Features = { true, true, 251 };
+        }
+
+        m_Encapsulation.start();
+
+        // Every update must reach the mock controller, rather than be
+        // deferred to the event queue, which the host never dispatches.
+        m_Encapsulation.m_MinimumCommitInterval = rtos::Kernel::Clock::duration(0);
+    }
+
+    int run()
+    {
+        printf("%-36s %12s %10s %10s %10s\r\n", "benchmark", "iterations", "ns/op", "allocs/op", "writes/op");
+
+        measure("ToString", true, []()
+                {
+                    for (size_t code = 0; code <= ERROR_CODES_TABLE_SIZE; ++code)
+                    {
+                        do_not_optimize(ToString(static_cast<ble_error_t>(code)));
+                    }
+                });
+
+        measure("load_legacy_advertising_payload", true, [this]()
+                {
+                    m_Encapsulation.m_AdvertisedFields.unbind_all();
+                    do_not_optimize(m_Encapsulation.load_legacy_advertising_payload());
+                });
+
+        measure("build_advertising_payload", true, [this]()
+                {
+                    m_Encapsulation.m_AdvertisedFields.unbind_all();
+                    do_not_optimize(m_Encapsulation.build_advertising_payload());
+                });
+
+        // Leave the payload the way start() made it for the update benchmarks.
+        m_Encapsulation.m_AdvertisedFields.unbind_all();
+        if (m_Encapsulation.uses_legacy_layout())
+        {
+            m_Encapsulation.load_legacy_advertising_payload();
+        }
+        else
+        {
+            m_Encapsulation.build_advertising_payload();
+        }
+
+        // The committed payload already holds the latest sample, so the
+        // update is skipped before it reaches the controller.
+        measure("update_battery_level (unchanged)", true, [this]()
+                {
+                    m_Encapsulation.update_battery_level();
+                });
+
+        measure("update_battery_level (changed)", true, [this]()
+                {
+                    m_Encapsulation.m_AdvertisedFields.sample_all();
+                    m_Encapsulation.update_battery_level();
+                });
+
+        // The stack turns the write down and takes it once it has
+        // processed its events, i.e. two writes per update.
+        measure("update_battery_level (stack busy)", true, [this]()
+                {
+                    m_Ble.gap().m_BusyPayloadWrites = 1;
+                    m_Encapsulation.m_AdvertisedFields.sample_all();
+                    m_Encapsulation.update_battery_level();
+                    m_Encapsulation.on_ble_events_processed();
+                });
+
+#if MBED_CONF_APP_CONNECTABLE
+        // A client connects, agrees on the largest ATT_MTU and subscribes,
+        // which turns every sample into a share of a notification.
+        m_Encapsulation.onConnectionComplete(ble::ConnectionCompleteEvent(BLE_ERROR_NONE, 1));
+        m_Ble.gattServer().subscribe_all(1, 247);
+
+        measure("sample_telemetry", true, [this]()
+                {
+                    m_Encapsulation.sample_telemetry();
+                });
+#endif
+
+#if MBED_CONF_APP_COMPACT_TELEMETRY
+        // Every sample moves the battery, every frame differs and goes to
+        // the controller. Extended sets carry no scan response.
+        if (!m_Encapsulation.m_ExtendedAdvertising)
+        {
+            measure("sample_compact_telemetry", true, [this]()
+                    {
+                        m_Encapsulation.m_AdvertisedFields.sample_all();
+                        m_Encapsulation.sample_compact_telemetry();
+                    });
+
+            check_compact_telemetry();
+        }
+#endif
+
+#if MBED_CONF_APP_OBSERVER
+        // A neighbour advertising a payload of legacy size, first over and
+        // over, then with a counter in it that changes every time. New
+        // reports go to a hook that drops them, rather than to the console.
+        uint8_t       report[ble::LEGACY_ADVERTISING_MAX_SIZE] = { 0x02, 0x01, 0x06 };
+        ble::address_t peer = {{ 0x11, 0x22, 0x33, 0x44, 0x55, 0xC6 }};
+        ble::AdvertisingReportEvent reportEvent(peer, ble::peer_address_type_t::RANDOM, -70, report);
+
+        m_Encapsulation.on_observed_report([](const ble::AdvertisingReportEvent &) {});
+
+        measure("onAdvertisingReport (duplicate)", true, [this, &reportEvent]()
+                {
+                    m_Encapsulation.onAdvertisingReport(reportEvent);
+                });
+
+        measure("onAdvertisingReport (changed)", true, [this, &report, &reportEvent]()
+                {
+                    ++report[sizeof(report) - 1];
+                    m_Encapsulation.onAdvertisingReport(reportEvent);
+                });
+
+        check_report_cache();
+#endif
+
+#if MBED_CONF_APP_HEALTH_COUNTERS
+        check_health_counters();
+#endif
+
+        return m_Failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+private:
+    template <typename F>
+    void measure(const char *name, bool allocationFree, F body)
+    {
+        // One call outside of the measurement, so that one-off lazy
+        // initialization is not charged to every call.
+        body();
+
+        const uint32_t writesBefore      = writes();
+        const size_t   allocationsBefore = gs_Allocations;
+        const auto     start             = std::chrono::steady_clock::now();
+
+        for (unsigned long i = 0; i < m_Iterations; ++i)
+        {
+            body();
+        }
+
+        const auto     end         = std::chrono::steady_clock::now();
+        const size_t   allocations = gs_Allocations - allocationsBefore;
+        const uint32_t writesAfter = writes();
+
+        const double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+
+        printf("%-36s %12lu %10.1f %10.3f %10.3f%s\r\n",
+               name,
+               m_Iterations,
+               nanoseconds / m_Iterations,
+               static_cast<double>(allocations) / m_Iterations,
+               static_cast<double>(writesAfter - writesBefore) / m_Iterations,
+               (allocationFree && allocations) ? "  <- allocates!" : "");
+
+        if (allocationFree && allocations)
+        {
+            m_Failed = true;
+        }
+    }
+
+#if MBED_CONF_APP_COMPACT_TELEMETRY
+    /** Decode the frames of a few more samples with the reference decoder,
+     *  and check that it gets the battery levels back. */
+    void check_compact_telemetry()
+    {
+        const CompactTelemetryEncoder_t &encoder = m_Encapsulation.m_CompactTelemetry;
+
+        CompactTelemetryDecoder<MBED_CONF_APP_COMPACT_TELEMETRY_MAX_CHANNELS> decoder;
+
+        for (size_t i = 0; i < encoder.channels(); ++i)
+        {
+            decoder.add_channel(encoder.channel(i));
+        }
+
+        typedef CompactTelemetryDecoder<MBED_CONF_APP_COMPACT_TELEMETRY_MAX_CHANNELS> Decoder_t;
+
+        bool     synchronised = false;
+        size_t   decoded      = 0;
+        int32_t  latest       = 0;
+        uint16_t sequence     = 0;
+        bool     ok           = true;
+
+        for (size_t sample = 0; ok && (sample < 4 * MBED_CONF_APP_COMPACT_TELEMETRY_KEYFRAME_INTERVAL); ++sample)
+        {
+            m_Encapsulation.m_AdvertisedFields.sample_all();
+            m_Encapsulation.sample_compact_telemetry();
+
+            // The scan response is a single manufacturer specific data
+            // structure, the frame following the company identifier.
+            const auto frame = m_Encapsulation.m_ScanResponse.subspan(2 + COMPACT_TELEMETRY_COMPANY_ID_SIZE);
+
+            decoded = 0;
+
+            const Decoder_t::Result_t result = decoder.decode(frame, [&](uint16_t number, mbed::Span<const int32_t> values)
+                                                              {
+                                                                  ++decoded;
+                                                                  sequence = number;
+                                                                  latest   = values[0];
+                                                              });
+
+            // The decoder joins mid-stream and waits for a keyframe, from
+            // then on every frame adds the one sample taken since.
+            if (!synchronised && (result == Decoder_t::MISSING_KEYFRAME))
+            {
+                continue;
+            }
+
+            ok = (result == Decoder_t::DECODED)
+                 && (synchronised ? (decoded == 1) : (decoded > 0))
+                 && (sequence == encoder.sequence())
+                 && (latest == m_Encapsulation.m_BatteryLevel.latest());
+
+            synchronised = true;
+        }
+
+        ok = ok && synchronised;
+
+        printf("%-36s %12s %s, %lu keyframes\r\n", "compact telemetry round trip", "",
+               ok ? "ok" : "FAILED", static_cast<unsigned long>(encoder.keyframes()));
+
+        if (!ok)
+        {
+            m_Failed = true;
+        }
+    }
+#endif
+
+#if MBED_CONF_APP_OBSERVER
+    /** Check that a peer going from payload A to B and back to A has every
+     *  change forwarded, and only the repeats dropped. */
+    void check_report_cache()
+    {
+        AdvertisingReportCache<MBED_CONF_APP_OBSERVER_CACHE_SIZE> cache;
+
+        const uint8_t address[AdvertisingReportCache<MBED_CONF_APP_OBSERVER_CACHE_SIZE>::ADDRESS_SIZE] =
+        {
+            0x66, 0x55, 0x44, 0x33, 0x22, 0xC1
+        };
+        const uint8_t payloadA[] = { 0x02, 0x01, 0x06, 0x03, 0xFF, 0x01, 0x00 };
+        const uint8_t payloadB[] = { 0x02, 0x01, 0x06, 0x03, 0xFF, 0x02, 0x00 };
+
+        const bool ok = cache.insert(address, 1, payloadA)
+                        && !cache.insert(address, 1, payloadA)
+                        && cache.insert(address, 1, payloadB)
+                        && !cache.insert(address, 1, payloadB)
+                        && cache.insert(address, 1, payloadA)
+                        && !cache.insert(address, 1, payloadA)
+                        && cache.insert(address, 0, payloadA)
+                        && (cache.duplicates() == 3)
+                        && (cache.evictions() == 0);
+
+        printf("%-36s %12s %s\r\n", "report cache A to B to A", "", ok ? "ok" : "FAILED");
+
+        if (!ok)
+        {
+            m_Failed = true;
+        }
+    }
+#endif
+
+#if MBED_CONF_APP_HEALTH_COUNTERS
+    /** Check that every advertising payload write that reached the
+     *  controller was counted, and the refused ones by their error. */
+    void check_health_counters()
+    {
+        const HealthCounters_t &counters = m_Encapsulation.m_HealthCounters;
+
+        // Once per call of the stack busy benchmark, including the one
+        // outside of the measurement.
+        const bool ok = (counters.payload_commits() + counters.commit_failures()
+                         == m_Ble.gap().m_Calls.m_SetAdvertisingPayload)
+                        && (counters.commit_failures(BLE_STACK_BUSY) == m_Iterations + 1)
+                        && (counters.commit_failures() == counters.commit_failures(BLE_STACK_BUSY));
+
+        printf("%-36s %12s %s, %lu writes, %lu refused\r\n", "health counters", "",
+               ok ? "ok" : "FAILED",
+               static_cast<unsigned long>(counters.payload_commits()),
+               static_cast<unsigned long>(counters.commit_failures()));
+
+        if (!ok)
+        {
+            m_Failed = true;
+        }
+    }
+#endif
+
+    uint32_t writes()
+    {
+        return m_Ble.gap().m_Calls.m_SetAdvertisingPayload
+               + m_Ble.gap().m_Calls.m_SetAdvertisingScanResponse
+               + m_Ble.gap().m_Calls.m_SetPeriodicAdvertisingPayload
+               + m_Ble.gattServer().m_Writes;
+    }
+
+    BLE                             m_Ble;
+    EventQueue_t                    m_EventQueue;
+    BluetoothLowEnergyEncapsulation m_Encapsulation;
+    unsigned long                   m_Iterations;
+    bool                            m_Failed;
+};
+
+int main(int argc, char *argv[])
+{
+    unsigned long iterations          = 1000000;
+    bool          extendedAdvertising = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--extended"))
+        {
+            extendedAdvertising = true;
+        }
+        else if (!(iterations = strtoul(argv[i], nullptr, 0)))
+        {
+            fprintf(stderr, "Usage: %s [--extended] [iterations]\r\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    BluetoothLowEnergyEncapsulationBenchmark benchmark(iterations, extendedAdvertising);
+
+    return benchmark.run();
+}
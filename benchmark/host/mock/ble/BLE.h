@@ -0,0 +1,92 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "ble/common/blecommon.h"
+#include "ble/common/UUID.h"
+#include "ble/gatt/GattService.h"
+#include "ble/Gap.h"
+#include "ble/GattServer.h"
+#include "ble/GattClient.h"
+#include "ble/SecurityManager.h"
+
+// Host stand-in for the BLE singleton. init() completes immediately and
+// there are never any events to process.
+class BLE
+{
+public:
+    struct InitializationCompleteCallbackContext
+    {
+        BLE &       ble;
+        ble_error_t error;
+    };
+
+    struct OnEventsToProcessCallbackContext
+    {
+        BLE & ble;
+    };
+
+    typedef void (*OnEventsToProcessCallback_t)(OnEventsToProcessCallbackContext *);
+
+    static BLE & Instance()
+    {
+        static BLE instance;
+        return instance;
+    }
+
+    template <typename T>
+    ble_error_t init(T *object, void (T::*completionCallback)(InitializationCompleteCallbackContext *))
+    {
+        InitializationCompleteCallbackContext context = { *this, BLE_ERROR_NONE };
+        (object->*completionCallback)(&context);
+        return BLE_ERROR_NONE;
+    }
+
+    ble::Gap & gap()
+    {
+        return m_Gap;
+    }
+
+    ble::GattServer & gattServer()
+    {
+        return m_GattServer;
+    }
+
+    ble::GattClient & gattClient()
+    {
+        return m_GattClient;
+    }
+
+    ble::SecurityManager & securityManager()
+    {
+        return m_SecurityManager;
+    }
+
+    void onEventsToProcess(OnEventsToProcessCallback_t)
+    {
+    }
+
+    void processEvents()
+    {
+    }
+
+private:
+    ble::Gap        m_Gap;
+    ble::GattServer m_GattServer;
+    ble::GattClient m_GattClient;
+    ble::SecurityManager m_SecurityManager;
+};
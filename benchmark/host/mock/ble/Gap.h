@@ -0,0 +1,1073 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "platform/Span.h"
+#include "ble/common/blecommon.h"
+#include "ble/common/UUID.h"
+
+// Host stand-in for the parts of ble::Gap the application uses.
+//
+// AdvertisingDataBuilder follows the real one closely enough to time: it
+// writes into the caller's buffer, replaces an existing AD structure of
+// the same type (and service UUID) in place and never allocates. Gap
+// completes every call at once and counts them, so a benchmark can tell
+// how many payload writes a code path would have sent to the controller.
+namespace ble
+{
+    struct adv_data_flags_t
+    {
+        enum
+        {
+            LE_LIMITED_DISCOVERABLE = 0x01,
+            LE_GENERAL_DISCOVERABLE = 0x02,
+            BREDR_NOT_SUPPORTED     = 0x04,
+            default_flags           = LE_GENERAL_DISCOVERABLE | BREDR_NOT_SUPPORTED
+        };
+    };
+
+    struct adv_data_type_t
+    {
+        enum type
+        {
+            FLAGS                           = 0x01,
+            COMPLETE_LIST_16BIT_SERVICE_IDS = 0x03,
+            SHORTENED_LOCAL_NAME            = 0x08,
+            COMPLETE_LOCAL_NAME             = 0x09,
+            SERVICE_DATA_16BIT_ID           = 0x16,
+            SERVICE_DATA                    = 0x16,
+            MANUFACTURER_SPECIFIC_DATA      = 0xFF
+        };
+
+        adv_data_type_t(type value)
+            : m_Value(value)
+        {
+        }
+
+        uint8_t value() const
+        {
+            return m_Value;
+        }
+
+        operator type() const
+        {
+            return m_Value;
+        }
+
+    private:
+        type m_Value;
+    };
+
+    typedef uint8_t advertising_handle_t;
+
+    const advertising_handle_t LEGACY_ADVERTISING_HANDLE = 0x00;
+    const advertising_handle_t INVALID_ADVERTISING_HANDLE = 0xFF;
+    const size_t LEGACY_ADVERTISING_MAX_SIZE = 31;
+
+    struct millisecond_t
+    {
+        explicit millisecond_t(uint32_t value)
+            : m_Value(value)
+        {
+        }
+
+        uint32_t value() const
+        {
+            return m_Value;
+        }
+
+    private:
+        uint32_t m_Value;
+    };
+
+    struct adv_interval_t
+    {
+        explicit adv_interval_t(millisecond_t interval)
+            : m_Milliseconds(interval.value())
+        {
+        }
+
+        uint32_t valueInMs() const
+        {
+            return m_Milliseconds;
+        }
+
+    private:
+        uint32_t m_Milliseconds;
+    };
+
+    struct periodic_interval_t
+    {
+        explicit periodic_interval_t(millisecond_t interval)
+            : m_Milliseconds(interval.value())
+        {
+        }
+
+        uint32_t valueInMs() const
+        {
+            return m_Milliseconds;
+        }
+
+    private:
+        uint32_t m_Milliseconds;
+    };
+
+    // Connection interval in units of 1.25 ms.
+    struct conn_interval_t
+    {
+        explicit conn_interval_t(uint16_t units)
+            : m_Units(units)
+        {
+        }
+
+        explicit conn_interval_t(millisecond_t interval)
+            : m_Units(static_cast<uint16_t>(interval.value() * 4 / 5))
+        {
+        }
+
+        uint16_t value() const
+        {
+            return m_Units;
+        }
+
+    private:
+        uint16_t m_Units;
+    };
+
+    struct slave_latency_t
+    {
+        explicit slave_latency_t(uint16_t value)
+            : m_Value(value)
+        {
+        }
+
+        uint16_t value() const
+        {
+            return m_Value;
+        }
+
+    private:
+        uint16_t m_Value;
+    };
+
+    // Supervision timeout in units of 10 ms.
+    struct supervision_timeout_t
+    {
+        explicit supervision_timeout_t(uint16_t units)
+            : m_Units(units)
+        {
+        }
+
+        uint16_t value() const
+        {
+            return m_Units;
+        }
+
+    private:
+        uint16_t m_Units;
+    };
+
+    struct phy_t
+    {
+        enum type
+        {
+            LE_1M = 1,
+            LE_2M = 2,
+            LE_CODED = 3
+        };
+
+        phy_t(type value)
+            : m_Value(value)
+        {
+        }
+
+    private:
+        type m_Value;
+    };
+
+    struct scan_interval_t
+    {
+        explicit scan_interval_t(millisecond_t interval)
+            : m_Milliseconds(interval.value())
+        {
+        }
+
+        uint32_t valueInMs() const
+        {
+            return m_Milliseconds;
+        }
+
+    private:
+        uint32_t m_Milliseconds;
+    };
+
+    typedef scan_interval_t scan_window_t;
+
+    struct scan_duration_t
+    {
+        static scan_duration_t forever()
+        {
+            return scan_duration_t();
+        }
+    };
+
+    struct duplicates_filter_t
+    {
+        enum type
+        {
+            DISABLE,
+            ENABLE,
+            PERIODIC_RESET
+        };
+
+        duplicates_filter_t(type value)
+            : m_Value(value)
+        {
+        }
+
+    private:
+        type m_Value;
+    };
+
+    class ScanParameters
+    {
+    public:
+        ScanParameters(phy_t,
+                       scan_window_t scanInterval,
+                       scan_window_t scanWindow,
+                       bool activeScanning = false)
+            : m_Interval(scanInterval)
+            , m_Window(scanWindow)
+            , m_Active(activeScanning)
+        {
+        }
+
+    private:
+        scan_interval_t m_Interval;
+        scan_window_t   m_Window;
+        bool            m_Active;
+    };
+
+    struct address_t
+    {
+        const uint8_t * data() const
+        {
+            return m_Bytes;
+        }
+
+        uint8_t m_Bytes[6];
+    };
+
+    struct peer_address_type_t
+    {
+        enum type
+        {
+            PUBLIC = 0,
+            RANDOM,
+            PUBLIC_IDENTITY,
+            RANDOM_STATIC_IDENTITY,
+            ANONYMOUS
+        };
+
+        peer_address_type_t(type value)
+            : m_Value(value)
+        {
+        }
+
+        type value() const
+        {
+            return m_Value;
+        }
+
+    private:
+        type m_Value;
+    };
+
+    typedef int8_t rssi_t;
+
+    struct own_address_type_t
+    {
+        enum type
+        {
+            PUBLIC = 0,
+            RANDOM,
+            RESOLVABLE_PRIVATE_ADDRESS_PUBLIC_FALLBACK,
+            RESOLVABLE_PRIVATE_ADDRESS_RANDOM_FALLBACK
+        };
+
+        own_address_type_t(type value = PUBLIC)
+            : m_Value(value)
+        {
+        }
+
+    private:
+        type m_Value;
+    };
+
+    struct advertising_type_t
+    {
+        enum type
+        {
+            CONNECTABLE_UNDIRECTED,
+            CONNECTABLE_DIRECTED,
+            SCANNABLE_UNDIRECTED,
+            NON_CONNECTABLE_UNDIRECTED
+        };
+
+        advertising_type_t(type value)
+            : m_Value(value)
+        {
+        }
+
+        type value() const
+        {
+            return m_Value;
+        }
+
+    private:
+        type m_Value;
+    };
+
+    struct controller_supported_features_t
+    {
+        enum type
+        {
+            LE_2M_PHY,
+            LE_CODED_PHY,
+            LE_EXTENDED_ADVERTISING,
+            LE_PERIODIC_ADVERTISING
+        };
+
+        controller_supported_features_t(type value)
+            : m_Value(value)
+        {
+        }
+
+        type value() const
+        {
+            return m_Value;
+        }
+
+    private:
+        type m_Value;
+    };
+
+    class AdvertisingParameters
+    {
+    public:
+        AdvertisingParameters(advertising_type_t advType = advertising_type_t::CONNECTABLE_UNDIRECTED,
+                              adv_interval_t minInterval = adv_interval_t(millisecond_t(1000)),
+                              adv_interval_t maxInterval = adv_interval_t(millisecond_t(1000)),
+                              bool useLegacyPDU = true)
+            : m_Type(advType)
+            , m_MinInterval(minInterval)
+            , m_MaxInterval(maxInterval)
+            , m_UseLegacyPDU(useLegacyPDU)
+        {
+        }
+
+        AdvertisingParameters & setPrimaryInterval(adv_interval_t minInterval, adv_interval_t maxInterval)
+        {
+            m_MinInterval = minInterval;
+            m_MaxInterval = maxInterval;
+            return *this;
+        }
+
+        AdvertisingParameters & setUseLegacyPDU(bool enable = true)
+        {
+            m_UseLegacyPDU = enable;
+            return *this;
+        }
+
+        AdvertisingParameters & setOwnAddressType(own_address_type_t addressType)
+        {
+            m_OwnAddressType = addressType;
+            return *this;
+        }
+
+        AdvertisingParameters & setScanRequestNotification(bool enable = true)
+        {
+            m_ScanRequestNotification = enable;
+            return *this;
+        }
+
+        advertising_type_t getType() const
+        {
+            return m_Type;
+        }
+
+        adv_interval_t getMinPrimaryInterval() const
+        {
+            return m_MinInterval;
+        }
+
+        bool getUseLegacyPDU() const
+        {
+            return m_UseLegacyPDU;
+        }
+
+    private:
+        advertising_type_t m_Type;
+        adv_interval_t     m_MinInterval;
+        adv_interval_t     m_MaxInterval;
+        bool               m_UseLegacyPDU;
+        own_address_type_t m_OwnAddressType;
+        bool               m_ScanRequestNotification = false;
+    };
+
+    struct peripheral_privacy_configuration_t
+    {
+        enum resolution_strategy_t
+        {
+            DO_NOT_RESOLVE,
+            REJECT_NON_RESOLVED_ADDRESS,
+            PERFORM_PAIRING_PROCEDURE,
+            PERFORM_AUTHENTICATION_PROCEDURE
+        };
+
+        bool                  use_non_resolvable_random_address;
+        resolution_strategy_t resolution_strategy;
+    };
+
+    class AdvertisingDataBuilder
+    {
+    public:
+        AdvertisingDataBuilder(mbed::Span<uint8_t> buffer)
+            : m_Buffer(buffer.data())
+            , m_Capacity(buffer.size())
+            , m_Length(0)
+        {
+        }
+
+        AdvertisingDataBuilder(uint8_t *buffer, size_t bufferSize)
+            : m_Buffer(buffer)
+            , m_Capacity(bufferSize)
+            , m_Length(0)
+        {
+        }
+
+        ble_error_t setFlags(uint8_t flags = adv_data_flags_t::default_flags)
+        {
+            return replace_or_append(adv_data_type_t::FLAGS, nullptr, 0, &flags, 1);
+        }
+
+        ble_error_t setName(const char *name, bool complete = true)
+        {
+            return replace_or_append(complete ? adv_data_type_t::COMPLETE_LOCAL_NAME
+                                              : adv_data_type_t::SHORTENED_LOCAL_NAME,
+                                     nullptr, 0,
+                                     reinterpret_cast<const uint8_t *>(name), strlen(name));
+        }
+
+        ble_error_t setServiceData(UUID service, mbed::Span<const uint8_t> data)
+        {
+            const uint8_t uuid[] = { static_cast<uint8_t>(service.getShortUUID()),
+                                     static_cast<uint8_t>(service.getShortUUID() >> 8) };
+
+            return replace_or_append(adv_data_type_t::SERVICE_DATA_16BIT_ID,
+                                     uuid, sizeof(uuid), data.data(), data.size());
+        }
+
+        ble_error_t setManufacturerSpecificData(mbed::Span<const uint8_t> data)
+        {
+            return replace_or_append(adv_data_type_t::MANUFACTURER_SPECIFIC_DATA,
+                                     nullptr, 0, data.data(), data.size());
+        }
+
+        void clear()
+        {
+            memset(m_Buffer, 0, m_Capacity);
+            m_Length = 0;
+        }
+
+        mbed::Span<const uint8_t> getAdvertisingData() const
+        {
+            return mbed::Span<const uint8_t>(m_Buffer, m_Length);
+        }
+
+    private:
+        // The AD structure of type whose data starts with prefix is replaced
+        // if present, otherwise one is appended.
+        ble_error_t replace_or_append(uint8_t type,
+                                      const uint8_t *prefix, size_t prefixSize,
+                                      const uint8_t *data, size_t dataSize)
+        {
+            const size_t fieldSize = 2 + prefixSize + dataSize;
+
+            if (fieldSize > 255 + 1)
+            {
+                return BLE_ERROR_INVALID_PARAM;
+            }
+
+            size_t position = 0;
+
+            while (position < m_Length)
+            {
+                const size_t existingSize = 1 + m_Buffer[position];
+
+                if ((m_Buffer[position + 1] == type)
+                    && (existingSize >= 2 + prefixSize)
+                    && ((prefixSize == 0) || !memcmp(&m_Buffer[position + 2], prefix, prefixSize)))
+                {
+                    if (m_Length - existingSize + fieldSize > m_Capacity)
+                    {
+                        return BLE_ERROR_BUFFER_OVERFLOW;
+                    }
+
+                    memmove(&m_Buffer[position],
+                            &m_Buffer[position + existingSize],
+                            m_Length - position - existingSize);
+                    m_Length -= existingSize;
+                    break;
+                }
+
+                position += existingSize;
+            }
+
+            if (m_Length + fieldSize > m_Capacity)
+            {
+                return BLE_ERROR_BUFFER_OVERFLOW;
+            }
+
+            uint8_t *field = &m_Buffer[m_Length];
+
+            field[0] = static_cast<uint8_t>(fieldSize - 1);
+            field[1] = type;
+
+            if (prefixSize)
+            {
+                memcpy(&field[2], prefix, prefixSize);
+            }
+
+            if (dataSize)
+            {
+                memcpy(&field[2 + prefixSize], data, dataSize);
+            }
+
+            m_Length += fieldSize;
+
+            return BLE_ERROR_NONE;
+        }
+
+        uint8_t * m_Buffer;
+        size_t    m_Capacity;
+        size_t    m_Length;
+    };
+
+    class AdvertisingStartEvent
+    {
+    public:
+        explicit AdvertisingStartEvent(advertising_handle_t handle)
+            : m_Handle(handle)
+        {
+        }
+
+        advertising_handle_t getAdvHandle() const
+        {
+            return m_Handle;
+        }
+
+    private:
+        advertising_handle_t m_Handle;
+    };
+
+    class AdvertisingEndEvent
+    {
+    public:
+        explicit AdvertisingEndEvent(advertising_handle_t handle)
+            : m_Handle(handle)
+        {
+        }
+
+        advertising_handle_t getAdvHandle() const
+        {
+            return m_Handle;
+        }
+
+        bool isConnected() const
+        {
+            return false;
+        }
+
+    private:
+        advertising_handle_t m_Handle;
+    };
+
+    class ScanRequestEvent
+    {
+    public:
+        ScanRequestEvent(advertising_handle_t handle,
+                         const peer_address_type_t &peerAddressType,
+                         const address_t &peerAddress)
+            : m_Handle(handle)
+            , m_PeerAddressType(peerAddressType)
+            , m_PeerAddress(peerAddress)
+        {
+        }
+
+        advertising_handle_t getAdvHandle() const
+        {
+            return m_Handle;
+        }
+
+        const peer_address_type_t & getPeerAddressType() const
+        {
+            return m_PeerAddressType;
+        }
+
+        const address_t & getPeerAddress() const
+        {
+            return m_PeerAddress;
+        }
+
+    private:
+        advertising_handle_t m_Handle;
+        peer_address_type_t  m_PeerAddressType;
+        const address_t &    m_PeerAddress;
+    };
+
+    class ConnectionCompleteEvent
+    {
+    public:
+        ConnectionCompleteEvent(ble_error_t status,
+                                connection_handle_t handle,
+                                conn_interval_t interval = conn_interval_t(millisecond_t(30)))
+            : m_Status(status)
+            , m_Handle(handle)
+            , m_Interval(interval)
+        {
+        }
+
+        ble_error_t getStatus() const
+        {
+            return m_Status;
+        }
+
+        connection_handle_t getConnectionHandle() const
+        {
+            return m_Handle;
+        }
+
+        const conn_interval_t & getConnectionInterval() const
+        {
+            return m_Interval;
+        }
+
+    private:
+        ble_error_t         m_Status;
+        connection_handle_t m_Handle;
+        conn_interval_t     m_Interval;
+    };
+
+    class UpdateConnectionParametersRequestEvent
+    {
+    public:
+        UpdateConnectionParametersRequestEvent(connection_handle_t handle,
+                                               conn_interval_t minInterval,
+                                               conn_interval_t maxInterval,
+                                               slave_latency_t latency,
+                                               supervision_timeout_t timeout)
+            : m_Handle(handle)
+            , m_MinInterval(minInterval)
+            , m_MaxInterval(maxInterval)
+            , m_Latency(latency)
+            , m_Timeout(timeout)
+        {
+        }
+
+        connection_handle_t getConnectionHandle() const
+        {
+            return m_Handle;
+        }
+
+        const conn_interval_t & getMinConnectionInterval() const
+        {
+            return m_MinInterval;
+        }
+
+        const conn_interval_t & getMaxConnectionInterval() const
+        {
+            return m_MaxInterval;
+        }
+
+        const slave_latency_t & getSlaveLatency() const
+        {
+            return m_Latency;
+        }
+
+        const supervision_timeout_t & getSupervisionTimeout() const
+        {
+            return m_Timeout;
+        }
+
+    private:
+        connection_handle_t   m_Handle;
+        conn_interval_t       m_MinInterval;
+        conn_interval_t       m_MaxInterval;
+        slave_latency_t       m_Latency;
+        supervision_timeout_t m_Timeout;
+    };
+
+    class ConnectionParametersUpdateCompleteEvent
+    {
+    public:
+        ConnectionParametersUpdateCompleteEvent(ble_error_t status,
+                                                connection_handle_t handle,
+                                                conn_interval_t interval)
+            : m_Status(status)
+            , m_Handle(handle)
+            , m_Interval(interval)
+        {
+        }
+
+        ble_error_t getStatus() const
+        {
+            return m_Status;
+        }
+
+        connection_handle_t getConnectionHandle() const
+        {
+            return m_Handle;
+        }
+
+        const conn_interval_t & getConnectionInterval() const
+        {
+            return m_Interval;
+        }
+
+    private:
+        ble_error_t         m_Status;
+        connection_handle_t m_Handle;
+        conn_interval_t     m_Interval;
+    };
+
+    class DisconnectionCompleteEvent
+    {
+    public:
+        explicit DisconnectionCompleteEvent(connection_handle_t handle)
+            : m_Handle(handle)
+        {
+        }
+
+        connection_handle_t getConnectionHandle() const
+        {
+            return m_Handle;
+        }
+
+    private:
+        connection_handle_t m_Handle;
+    };
+
+    class AdvertisingReportEvent
+    {
+    public:
+        AdvertisingReportEvent(const address_t &peerAddress,
+                               peer_address_type_t peerAddressType,
+                               rssi_t rssi,
+                               mbed::Span<const uint8_t> payload)
+            : m_PeerAddress(peerAddress)
+            , m_PeerAddressType(peerAddressType)
+            , m_Rssi(rssi)
+            , m_Payload(payload)
+        {
+        }
+
+        const address_t & getPeerAddress() const
+        {
+            return m_PeerAddress;
+        }
+
+        const peer_address_type_t & getPeerAddressType() const
+        {
+            return m_PeerAddressType;
+        }
+
+        rssi_t getRssi() const
+        {
+            return m_Rssi;
+        }
+
+        const mbed::Span<const uint8_t> & getPayload() const
+        {
+            return m_Payload;
+        }
+
+    private:
+        const address_t &         m_PeerAddress;
+        peer_address_type_t       m_PeerAddressType;
+        rssi_t                    m_Rssi;
+        mbed::Span<const uint8_t> m_Payload;
+    };
+
+    class Gap
+    {
+    public:
+        struct EventHandler
+        {
+            virtual void onAdvertisingStart(const AdvertisingStartEvent &)
+            {
+            }
+
+            virtual void onAdvertisingEnd(const AdvertisingEndEvent &)
+            {
+            }
+
+            virtual void onAdvertisingReport(const AdvertisingReportEvent &)
+            {
+            }
+
+            virtual void onScanRequestReceived(const ScanRequestEvent &)
+            {
+            }
+
+            virtual void onConnectionComplete(const ConnectionCompleteEvent &)
+            {
+            }
+
+            virtual void onDisconnectionComplete(const DisconnectionCompleteEvent &)
+            {
+            }
+
+            virtual void onDataLengthChange(connection_handle_t, uint16_t, uint16_t)
+            {
+            }
+
+            virtual void onUpdateConnectionParametersRequest(const UpdateConnectionParametersRequestEvent &)
+            {
+            }
+
+            virtual void onConnectionParametersUpdateComplete(const ConnectionParametersUpdateCompleteEvent &)
+            {
+            }
+
+            virtual void onPrivacyEnabled()
+            {
+            }
+
+        protected:
+            ~EventHandler()
+            {
+            }
+        };
+
+        // What the "controller" supports, set by the benchmark before
+        // BLE::init(). Legacy advertising only by default.
+        struct Features_t
+        {
+            bool   m_ExtendedAdvertising;
+            bool   m_PeriodicAdvertising;
+            size_t m_MaxAdvertisingDataLength;
+        };
+
+        // Calls made so far, by kind.
+        struct Calls_t
+        {
+            uint32_t m_SetAdvertisingParameters;
+            uint32_t m_SetAdvertisingPayload;
+            uint32_t m_SetAdvertisingScanResponse;
+            uint32_t m_StartAdvertising;
+            uint32_t m_StopAdvertising;
+            uint32_t m_SetPeriodicAdvertisingPayload;
+        };
+
+        Gap()
+            : m_Features{ false, false, LEGACY_ADVERTISING_MAX_SIZE }
+            , m_Calls()
+            , m_BusyPayloadWrites(0)
+            , m_EventHandler(nullptr)
+            , m_AdvertisingSets(0)
+        {
+        }
+
+        void setEventHandler(EventHandler *handler)
+        {
+            m_EventHandler = handler;
+        }
+
+        bool isFeatureSupported(controller_supported_features_t feature)
+        {
+            switch (feature.value())
+            {
+                case controller_supported_features_t::LE_EXTENDED_ADVERTISING:
+                    return m_Features.m_ExtendedAdvertising;
+                case controller_supported_features_t::LE_PERIODIC_ADVERTISING:
+                    return m_Features.m_PeriodicAdvertising;
+                default:
+                    return false;
+            }
+        }
+
+        uint16_t getMaxAdvertisingDataLength()
+        {
+            return static_cast<uint16_t>(m_Features.m_MaxAdvertisingDataLength);
+        }
+
+        ble_error_t createAdvertisingSet(advertising_handle_t *handle, const AdvertisingParameters &)
+        {
+            *handle = ++m_AdvertisingSets;
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t destroyAdvertisingSet(advertising_handle_t)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t setAdvertisingParameters(advertising_handle_t, const AdvertisingParameters &)
+        {
+            ++m_Calls.m_SetAdvertisingParameters;
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t setAdvertisingPayload(advertising_handle_t, mbed::Span<const uint8_t> payload)
+        {
+            ++m_Calls.m_SetAdvertisingPayload;
+
+            if (m_BusyPayloadWrites > 0)
+            {
+                --m_BusyPayloadWrites;
+                return BLE_STACK_BUSY;
+            }
+
+            return check_size(payload);
+        }
+
+        ble_error_t setAdvertisingScanResponse(advertising_handle_t, mbed::Span<const uint8_t> response)
+        {
+            ++m_Calls.m_SetAdvertisingScanResponse;
+            return check_size(response);
+        }
+
+        ble_error_t startAdvertising(advertising_handle_t)
+        {
+            ++m_Calls.m_StartAdvertising;
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t stopAdvertising(advertising_handle_t handle)
+        {
+            ++m_Calls.m_StopAdvertising;
+
+            // The real stack reports the end asynchronously; here it is
+            // as good as immediate.
+            if (m_EventHandler)
+            {
+                m_EventHandler->onAdvertisingEnd(AdvertisingEndEvent(handle));
+            }
+
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t getAddress(own_address_type_t &type, address_t &address)
+        {
+            const address_t own = {{ 0x3C, 0x2B, 0x1A, 0xE1, 0x80, 0x00 }};
+
+            type    = own_address_type_t::PUBLIC;
+            address = own;
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t setPeripheralPrivacyConfiguration(const peripheral_privacy_configuration_t *)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t setPrivateAddressTimeout(uint16_t)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t enablePrivacy(bool enable)
+        {
+            if (enable && m_EventHandler)
+            {
+                m_EventHandler->onPrivacyEnabled();
+            }
+
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t setScanParameters(const ScanParameters &)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t startScan(scan_duration_t = scan_duration_t::forever(),
+                              duplicates_filter_t = duplicates_filter_t::DISABLE)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t manageConnectionParametersUpdateRequest(bool)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t acceptConnectionParametersUpdate(connection_handle_t,
+                                                     conn_interval_t,
+                                                     conn_interval_t,
+                                                     slave_latency_t,
+                                                     supervision_timeout_t)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t setPeriodicAdvertisingParameters(advertising_handle_t,
+                                                     periodic_interval_t,
+                                                     periodic_interval_t,
+                                                     bool = true)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t setPeriodicAdvertisingPayload(advertising_handle_t, mbed::Span<const uint8_t> payload)
+        {
+            ++m_Calls.m_SetPeriodicAdvertisingPayload;
+            return check_size(payload);
+        }
+
+        ble_error_t startPeriodicAdvertising(advertising_handle_t)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t stopPeriodicAdvertising(advertising_handle_t)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        Features_t m_Features;
+        Calls_t    m_Calls;
+
+        // Number of upcoming setAdvertisingPayload() calls to reject with
+        // BLE_STACK_BUSY, as a stack with its HCI buffers full would.
+        uint32_t   m_BusyPayloadWrites;
+
+    private:
+        ble_error_t check_size(mbed::Span<const uint8_t> data) const
+        {
+            return (data.size() <= m_Features.m_MaxAdvertisingDataLength) ? BLE_ERROR_NONE
+                                                                          : BLE_ERROR_INVALID_PARAM;
+        }
+
+        EventHandler *       m_EventHandler;
+        advertising_handle_t m_AdvertisingSets;
+    };
+}
@@ -0,0 +1,135 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "ble/common/blecommon.h"
+#include "ble/gatt/GattCharacteristic.h"
+#include "ble/gatt/GattService.h"
+#include "ble/gatt/GattCallbackParamTypes.h"
+
+namespace ble
+{
+    // Hands out attribute handles and counts writes, which complete at once.
+    class GattServer
+    {
+    public:
+        struct EventHandler
+        {
+            virtual void onDataSent(const GattDataSentCallbackParams &)
+            {
+            }
+
+            virtual void onUpdatesEnabled(const GattUpdatesEnabledCallbackParams &)
+            {
+            }
+
+            virtual void onUpdatesDisabled(const GattUpdatesDisabledCallbackParams &)
+            {
+            }
+
+            virtual void onAttMtuChange(connection_handle_t, uint16_t)
+            {
+            }
+
+        protected:
+            ~EventHandler()
+            {
+            }
+        };
+
+        GattServer()
+            : m_Writes(0)
+            , m_BytesWritten(0)
+            , m_EventHandler(nullptr)
+            , m_NextHandle(1)
+            , m_ValueHandleCount(0)
+        {
+        }
+
+        ble_error_t addService(GattService &service)
+        {
+            // Service declaration, then a declaration and a value per
+            // characteristic, as a real server would number them.
+            ++m_NextHandle;
+
+            for (unsigned i = 0; i < service.getCharacteristicCount(); ++i)
+            {
+                const GattAttribute::Handle_t valueHandle = static_cast<GattAttribute::Handle_t>(m_NextHandle + 1);
+
+                service.getCharacteristic(i)->setValueHandle(valueHandle);
+
+                if (m_ValueHandleCount < MAX_CHARACTERISTICS)
+                {
+                    m_ValueHandles[m_ValueHandleCount++] = valueHandle;
+                }
+
+                m_NextHandle = static_cast<GattAttribute::Handle_t>(m_NextHandle + 3);
+            }
+
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t write(GattAttribute::Handle_t, const uint8_t *, uint16_t size, bool = false)
+        {
+            ++m_Writes;
+            m_BytesWritten += size;
+            return BLE_ERROR_NONE;
+        }
+
+        void setEventHandler(EventHandler *handler)
+        {
+            m_EventHandler = handler;
+        }
+
+        EventHandler * getEventHandler() const
+        {
+            return m_EventHandler;
+        }
+
+        /** Act as a client that subscribes to every characteristic and has
+         *  agreed on attMtu. */
+        void subscribe_all(connection_handle_t connection, uint16_t attMtu)
+        {
+            if (!m_EventHandler)
+            {
+                return;
+            }
+
+            m_EventHandler->onAttMtuChange(connection, attMtu);
+
+            for (size_t i = 0; i < m_ValueHandleCount; ++i)
+            {
+                m_EventHandler->onUpdatesEnabled(GattUpdatesEnabledCallbackParams{ connection, m_ValueHandles[i] });
+            }
+        }
+
+        uint32_t m_Writes;
+        uint32_t m_BytesWritten;
+
+    private:
+        static constexpr size_t MAX_CHARACTERISTICS = 8;
+
+        EventHandler *          m_EventHandler;
+        GattAttribute::Handle_t m_NextHandle;
+        GattAttribute::Handle_t m_ValueHandles[MAX_CHARACTERISTICS];
+        size_t                  m_ValueHandleCount;
+    };
+}
+
+using ble::GattServer;
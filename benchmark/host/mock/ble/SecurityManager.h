@@ -0,0 +1,48 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "ble/common/blecommon.h"
+
+namespace ble
+{
+    class SecurityManager
+    {
+    public:
+        enum SecurityIOCapabilities_t
+        {
+            IO_CAPS_DISPLAY_ONLY,
+            IO_CAPS_DISPLAY_YESNO,
+            IO_CAPS_KEYBOARD_ONLY,
+            IO_CAPS_NONE,
+            IO_CAPS_KEYBOARD_DISPLAY
+        };
+
+        ble_error_t init(bool = true,
+                         bool = true,
+                         SecurityIOCapabilities_t = IO_CAPS_NONE,
+                         const uint8_t * = nullptr,
+                         bool = true,
+                         const char * = nullptr)
+        {
+            return BLE_ERROR_NONE;
+        }
+    };
+}
+
+using ble::SecurityManager;
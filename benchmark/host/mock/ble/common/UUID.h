@@ -0,0 +1,45 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// 16-bit UUIDs are what gets advertised, 128-bit ones are only named.
+class UUID
+{
+public:
+    typedef uint16_t ShortUUIDBytes_t;
+
+    UUID(ShortUUIDBytes_t shortUuid)
+        : m_ShortUuid(shortUuid)
+    {
+    }
+
+    // A 128-bit UUID in its string form; the host has no use for its value.
+    UUID(const char *)
+        : m_ShortUuid(0)
+    {
+    }
+
+    ShortUUIDBytes_t getShortUUID() const
+    {
+        return m_ShortUuid;
+    }
+
+private:
+    ShortUUIDBytes_t m_ShortUuid;
+};
@@ -0,0 +1,52 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// Same values as the real ble_error_t, which gs_ErrorCodesTable is indexed by.
+enum ble_error_t
+{
+    BLE_ERROR_NONE                      = 0,
+    BLE_ERROR_BUFFER_OVERFLOW           = 1,
+    BLE_ERROR_NOT_IMPLEMENTED           = 2,
+    BLE_ERROR_PARAM_OUT_OF_RANGE        = 3,
+    BLE_ERROR_INVALID_PARAM             = 4,
+    BLE_STACK_BUSY                      = 5,
+    BLE_ERROR_INVALID_STATE             = 6,
+    BLE_ERROR_NO_MEM                    = 7,
+    BLE_ERROR_OPERATION_NOT_PERMITTED   = 8,
+    BLE_ERROR_INITIALIZATION_INCOMPLETE = 9,
+    BLE_ERROR_ALREADY_INITIALIZED       = 10,
+    BLE_ERROR_UNSPECIFIED               = 11,
+    BLE_ERROR_INTERNAL_STACK_FAILURE    = 12,
+    BLE_ERROR_NOT_FOUND                 = 13
+};
+
+#include <cstdint>
+
+namespace ble
+{
+    typedef uint16_t connection_handle_t;
+}
+
+// The host build exposes every advertising feature; the mock Gap decides
+// at run time whether the "controller" supports it.
+#define BLE_FEATURE_EXTENDED_ADVERTISING 1
+#define BLE_FEATURE_PERIODIC_ADVERTISING 1
+#define BLE_FEATURE_GATT_SERVER 1
+#define BLE_FEATURE_GATT_CLIENT 1
+#define BLE_FEATURE_SECURITY 1
+#define BLE_FEATURE_PRIVACY 1
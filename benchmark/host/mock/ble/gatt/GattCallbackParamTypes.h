@@ -0,0 +1,34 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "ble/common/blecommon.h"
+#include "ble/gatt/GattCharacteristic.h"
+
+struct GattDataSentCallbackParams
+{
+    ble::connection_handle_t connHandle;
+    GattAttribute::Handle_t  attHandle;
+};
+
+struct GattUpdatesEnabledCallbackParams
+{
+    ble::connection_handle_t connHandle;
+    GattAttribute::Handle_t  attHandle;
+};
+
+typedef GattUpdatesEnabledCallbackParams GattUpdatesDisabledCallbackParams;
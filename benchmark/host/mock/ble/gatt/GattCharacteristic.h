@@ -0,0 +1,82 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "ble/common/UUID.h"
+
+class GattAttribute
+{
+public:
+    typedef uint16_t Handle_t;
+};
+
+class GattCharacteristic
+{
+public:
+    enum
+    {
+        UUID_BATTERY_LEVEL_CHAR = 0x2A19
+    };
+
+    enum Properties_t
+    {
+        BLE_GATT_CHAR_PROPERTIES_NONE                   = 0x00,
+        BLE_GATT_CHAR_PROPERTIES_BROADCAST              = 0x01,
+        BLE_GATT_CHAR_PROPERTIES_READ                   = 0x02,
+        BLE_GATT_CHAR_PROPERTIES_WRITE_WITHOUT_RESPONSE = 0x04,
+        BLE_GATT_CHAR_PROPERTIES_WRITE                  = 0x08,
+        BLE_GATT_CHAR_PROPERTIES_NOTIFY                 = 0x10,
+        BLE_GATT_CHAR_PROPERTIES_INDICATE               = 0x20
+    };
+
+    GattCharacteristic(const UUID &uuid,
+                       uint8_t *valuePtr = nullptr,
+                       uint16_t len = 0,
+                       uint16_t maxLen = 0,
+                       uint8_t props = BLE_GATT_CHAR_PROPERTIES_NONE,
+                       GattAttribute *descriptors[] = nullptr,
+                       unsigned numDescriptors = 0,
+                       bool hasVariableLen = true)
+        : m_Uuid(uuid)
+        , m_Value(valuePtr)
+        , m_Length(len)
+        , m_MaxLength(maxLen)
+        , m_Properties(props)
+        , m_ValueHandle(0)
+    {
+    }
+
+    GattAttribute::Handle_t getValueHandle() const
+    {
+        return m_ValueHandle;
+    }
+
+    // Set by the mock GattServer when the service is added.
+    void setValueHandle(GattAttribute::Handle_t handle)
+    {
+        m_ValueHandle = handle;
+    }
+
+private:
+    UUID                    m_Uuid;
+    uint8_t *               m_Value;
+    uint16_t                m_Length;
+    uint16_t                m_MaxLength;
+    uint8_t                 m_Properties;
+    GattAttribute::Handle_t m_ValueHandle;
+};
@@ -0,0 +1,51 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "ble/common/UUID.h"
+#include "ble/gatt/GattCharacteristic.h"
+
+class GattService
+{
+public:
+    enum
+    {
+        UUID_BATTERY_SERVICE = 0x180F
+    };
+
+    GattService(const UUID &uuid, GattCharacteristic *characteristics[], unsigned numCharacteristics)
+        : m_Uuid(uuid)
+        , m_Characteristics(characteristics)
+        , m_CharacteristicCount(numCharacteristics)
+    {
+    }
+
+    unsigned getCharacteristicCount() const
+    {
+        return m_CharacteristicCount;
+    }
+
+    GattCharacteristic * getCharacteristic(unsigned index)
+    {
+        return m_Characteristics[index];
+    }
+
+private:
+    UUID                 m_Uuid;
+    GattCharacteristic **m_Characteristics;
+    unsigned             m_CharacteristicCount;
+};
@@ -0,0 +1,86 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include "platform/Callback.h"
+
+#define EVENTS_EVENT_SIZE 64
+#define EVENTS_QUEUE_SIZE (32 * EVENTS_EVENT_SIZE)
+
+namespace events
+{
+    // Accepts and counts events without ever running them. The
+    // benchmarks call the handlers they time directly, so the queue only
+    // needs to say how much the code under test posted.
+    class EventQueue
+    {
+    public:
+        explicit EventQueue(size_t = EVENTS_QUEUE_SIZE, unsigned char * = nullptr)
+            : m_Posted(0)
+        {
+        }
+
+        template <typename F>
+        int call(F)
+        {
+            return post();
+        }
+
+        template <typename T, typename R>
+        int call(T *, R (T::*)())
+        {
+            return post();
+        }
+
+        template <typename Duration, typename F>
+        int call_in(Duration, F)
+        {
+            return post();
+        }
+
+        template <typename Duration, typename F>
+        int call_every(Duration, F)
+        {
+            return post();
+        }
+
+        bool cancel(int)
+        {
+            return true;
+        }
+
+        void dispatch_forever()
+        {
+        }
+
+        unsigned posted() const
+        {
+            return m_Posted;
+        }
+
+    private:
+        int post()
+        {
+            return static_cast<int>(++m_Posted);
+        }
+
+        unsigned m_Posted;
+    };
+}
+
+using events::EventQueue;
@@ -0,0 +1,54 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Host stand-in for the TRNG HAL, handing out a fixed pseudo-random
+// sequence so that runs can be compared.
+#ifndef DEVICE_TRNG
+#define DEVICE_TRNG 1
+#endif
+
+struct trng_t
+{
+};
+
+inline void trng_init(trng_t *)
+{
+}
+
+inline void trng_free(trng_t *)
+{
+}
+
+inline int trng_get_bytes(trng_t *, uint8_t *output, size_t length, size_t *output_length)
+{
+    static uint32_t state = 0x2545F491;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        output[i] = static_cast<uint8_t>(state);
+    }
+
+    *output_length = length;
+    return 0;
+}
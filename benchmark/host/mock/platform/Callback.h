@@ -0,0 +1,89 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+
+// Host stand-in for mbed::Callback. Unlike the real one it may allocate
+// when a large functor is stored; the benchmarks only create callbacks
+// outside of the timed loops.
+namespace mbed
+{
+    template <typename F>
+    class Callback;
+
+    template <typename R, typename... Args>
+    class Callback<R(Args...)>
+    {
+    public:
+        Callback()
+        {
+        }
+
+        template <typename T, typename U>
+        Callback(T *object, R (U::*method)(Args...))
+            : m_Function([object, method](Args... args) { return (object->*method)(args...); })
+        {
+        }
+
+        template <typename T, typename U>
+        Callback(const T *object, R (U::*method)(Args...) const)
+            : m_Function([object, method](Args... args) { return (object->*method)(args...); })
+        {
+        }
+
+        template <typename F>
+        Callback(F function)
+            : m_Function(function)
+        {
+        }
+
+        R operator()(Args... args) const
+        {
+            return m_Function(args...);
+        }
+
+        explicit operator bool() const
+        {
+            return static_cast<bool>(m_Function);
+        }
+
+    private:
+        std::function<R(Args...)> m_Function;
+    };
+
+    template <typename T, typename U, typename R, typename... Args>
+    Callback<R(Args...)> callback(T *object, R (U::*method)(Args...))
+    {
+        return Callback<R(Args...)>(object, method);
+    }
+
+    template <typename T, typename U, typename R, typename... Args>
+    Callback<R(Args...)> callback(const T *object, R (U::*method)(Args...) const)
+    {
+        return Callback<R(Args...)>(object, method);
+    }
+
+    template <typename R, typename... Args>
+    Callback<R(Args...)> callback(R (*function)(Args...))
+    {
+        return Callback<R(Args...)>(function);
+    }
+}
+
+using mbed::Callback;
+using mbed::callback;
@@ -0,0 +1,128 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+// Host stand-in for mbed::Span, dynamic extent only.
+namespace mbed
+{
+    template <typename T>
+    class Span
+    {
+    public:
+        Span()
+            : m_Data(nullptr)
+            , m_Size(0)
+        {
+        }
+
+        Span(T *data, size_t size)
+            : m_Data(data)
+            , m_Size(size)
+        {
+        }
+
+        template <size_t Size>
+        Span(T (&elements)[Size])
+            : m_Data(elements)
+            , m_Size(Size)
+        {
+        }
+
+        // Span<T> converts to Span<const T>.
+        template <typename U>
+        Span(const Span<U> &other)
+            : m_Data(other.data())
+            , m_Size(other.size())
+        {
+        }
+
+        T * data() const
+        {
+            return m_Data;
+        }
+
+        size_t size() const
+        {
+            return m_Size;
+        }
+
+        bool empty() const
+        {
+            return m_Size == 0;
+        }
+
+        T & operator[](size_t index) const
+        {
+            return m_Data[index];
+        }
+
+        T * begin() const
+        {
+            return m_Data;
+        }
+
+        T * end() const
+        {
+            return m_Data + m_Size;
+        }
+
+        Span first(size_t count) const
+        {
+            return Span(m_Data, count);
+        }
+
+        Span subspan(size_t offset, size_t count) const
+        {
+            return Span(m_Data + offset, count);
+        }
+
+        Span subspan(size_t offset) const
+        {
+            return Span(m_Data + offset, m_Size - offset);
+        }
+
+    private:
+        T *    m_Data;
+        size_t m_Size;
+    };
+
+    template <typename T>
+    Span<T> make_Span(T *data, size_t size)
+    {
+        return Span<T>(data, size);
+    }
+
+    template <typename T, size_t Size>
+    Span<T> make_Span(T (&elements)[Size])
+    {
+        return Span<T>(elements);
+    }
+
+    template <typename T>
+    Span<const T> make_const_Span(const T *data, size_t size)
+    {
+        return Span<const T>(data, size);
+    }
+
+    template <typename T, size_t Size>
+    Span<const T> make_const_Span(const T (&elements)[Size])
+    {
+        return Span<const T>(elements);
+    }
+}
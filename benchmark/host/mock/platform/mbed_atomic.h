@@ -0,0 +1,69 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// Single threaded stand-ins; the host benchmarks never share these.
+inline uint32_t core_util_atomic_incr_u32(volatile uint32_t *value, uint32_t delta)
+{
+    return *value += delta;
+}
+
+inline uint32_t core_util_atomic_decr_u32(volatile uint32_t *value, uint32_t delta)
+{
+    return *value -= delta;
+}
+
+inline uint32_t core_util_atomic_load_u32(const volatile uint32_t *value)
+{
+    return *value;
+}
+
+inline void core_util_atomic_store_u32(volatile uint32_t *value, uint32_t desired)
+{
+    *value = desired;
+}
+
+inline uint32_t core_util_atomic_exchange_u32(volatile uint32_t *value, uint32_t desired)
+{
+    const uint32_t previous = *value;
+    *value = desired;
+    return previous;
+}
+
+inline bool core_util_atomic_cas_u32(volatile uint32_t *value, uint32_t *expected, uint32_t desired)
+{
+    if (*value == *expected)
+    {
+        *value = desired;
+        return true;
+    }
+
+    *expected = *value;
+    return false;
+}
+
+inline bool core_util_atomic_load_bool(const volatile bool *value)
+{
+    return *value;
+}
+
+inline void core_util_atomic_store_bool(volatile bool *value, bool desired)
+{
+    *value = desired;
+}
@@ -0,0 +1,39 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// Host stand-in for the CPU statistics: a CPU that is never idle.
+#ifndef MBED_CPU_STATS_ENABLED
+#define MBED_CPU_STATS_ENABLED 1
+#endif
+
+typedef uint64_t us_timestamp_t;
+
+typedef struct
+{
+    us_timestamp_t uptime;
+    us_timestamp_t idle_time;
+    us_timestamp_t sleep_time;
+    us_timestamp_t deep_sleep_time;
+} mbed_stats_cpu_t;
+
+inline void mbed_stats_cpu_get(mbed_stats_cpu_t *stats)
+{
+    *stats = mbed_stats_cpu_t();
+}
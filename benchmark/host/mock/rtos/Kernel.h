@@ -0,0 +1,42 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+
+namespace rtos
+{
+    namespace Kernel
+    {
+        // Milliseconds since the host process started.
+        struct Clock
+        {
+            using duration   = std::chrono::milliseconds;
+            using rep        = duration::rep;
+            using period     = duration::period;
+            using time_point = std::chrono::time_point<Clock, duration>;
+
+            static constexpr bool is_steady = true;
+
+            static time_point now()
+            {
+                static const auto start = std::chrono::steady_clock::now();
+                return time_point(std::chrono::duration_cast<duration>(std::chrono::steady_clock::now() - start));
+            }
+        };
+    }
+}
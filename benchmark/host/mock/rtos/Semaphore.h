@@ -0,0 +1,56 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace rtos
+{
+    class Semaphore
+    {
+    public:
+        explicit Semaphore(int32_t count = 0, uint16_t = 0xFFFF)
+            : m_Count(count)
+        {
+        }
+
+        void acquire()
+        {
+            --m_Count;
+        }
+
+        bool try_acquire()
+        {
+            if (m_Count > 0)
+            {
+                --m_Count;
+                return true;
+            }
+
+            return false;
+        }
+
+        int32_t release()
+        {
+            ++m_Count;
+            return 0;
+        }
+
+    private:
+        int32_t m_Count;
+    };
+}
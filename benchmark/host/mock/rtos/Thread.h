@@ -0,0 +1,51 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "platform/Callback.h"
+
+enum osPriority
+{
+    osPriorityIdle        = 1,
+    osPriorityLow         = 8,
+    osPriorityBelowNormal = 16,
+    osPriorityNormal      = 24,
+    osPriorityAboveNormal = 32,
+    osPriorityHigh        = 40,
+    osPriorityRealtime    = 48
+};
+
+typedef int32_t osStatus;
+
+namespace rtos
+{
+    // Never runs anything: the host benchmarks are single threaded and
+    // drive the event queues themselves.
+    class Thread
+    {
+    public:
+        Thread(osPriority = osPriorityNormal, uint32_t = 0, unsigned char * = nullptr, const char * = nullptr)
+        {
+        }
+
+        osStatus start(mbed::Callback<void()>)
+        {
+            return 0;
+        }
+    };
+}
@@ -0,0 +1,75 @@
+# Copyright (c) 2020 ARM Limited. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+# Fails the build if a function of the payload update path survived out of
+# line in a release image.
+#
+# Run as a script after the build:
+#
+#   cmake -DELF=<image> -DNM=<arm-none-eabi-nm> -P CheckInlining.cmake
+#
+# The work update_battery_level() and schedule_ble_events() do every
+# cycle is spread over small helpers, for readability. They only cost
+# nothing when the compiler folds them into their callers, and a helper
+# growing a second caller, or a change of flags, can quietly stop that.
+# Every one of them is either tiny or called from a single place, so a
+# symbol of its own in the image means it was not inlined. That includes
+# the copies GCC names "<function> [clone .constprop.0]" and the like
+# under -Os, -O2 and LTO. A sample listing with such a copy is checked
+# first, so that the matching cannot quietly go blind to them.
+
+set(INLINED_FUNCTIONS
+    "process_ble_events(BLE&)"
+    "BluetoothLowEnergyEncapsulation::begin_payload_update()"
+    "BluetoothLowEnergyEncapsulation::commit_payload_update()"
+    "BluetoothLowEnergyEncapsulation::update_advertising_interval()"
+    "BluetoothLowEnergyEncapsulation::is_retryable(ble_error_t)"
+)
+
+# The functions of INLINED_FUNCTIONS with a symbol in the nm listing
+# SYMBOLS, out of line or as a clone.
+function(find_out_of_line SYMBOLS RESULT)
+    set(FOUND)
+
+    foreach(FUNCTION IN LISTS INLINED_FUNCTIONS)
+        string(REGEX REPLACE "([][().*+?^$|&\\])" "\\\\\\1" PATTERN "${FUNCTION}")
+        string(REGEX MATCH " ${PATTERN}(\n|$| \\[clone )" MATCH "${SYMBOLS}")
+
+        if(MATCH)
+            list(APPEND FOUND "${FUNCTION}")
+        endif()
+    endforeach()
+
+    set(${RESULT} "${FOUND}" PARENT_SCOPE)
+endfunction()
+
+set(SAMPLE_SYMBOLS
+"08001000 T main
+08001100 t process_ble_events(BLE&) [clone .constprop.0]
+08001200 W BluetoothLowEnergyEncapsulation::update_battery_level()
+")
+
+find_out_of_line("${SAMPLE_SYMBOLS}" SAMPLE_OUT_OF_LINE)
+
+if(NOT SAMPLE_OUT_OF_LINE STREQUAL "process_ble_events(BLE&)")
+    message(FATAL_ERROR "Inlining check does not tell clones apart: found \"${SAMPLE_OUT_OF_LINE}\" in the sample")
+endif()
+
+execute_process(
+    COMMAND ${NM} --demangle ${ELF}
+    OUTPUT_VARIABLE SYMBOLS
+    RESULT_VARIABLE NM_RESULT
+)
+
+if(NOT NM_RESULT EQUAL 0)
+    message(FATAL_ERROR "Inlining check failed to run ${NM} on ${ELF}")
+endif()
+
+find_out_of_line("${SYMBOLS}" OUT_OF_LINE)
+
+if(OUT_OF_LINE)
+    string(REPLACE ";" "\n  " OUT_OF_LINE "${OUT_OF_LINE}")
+    message(FATAL_ERROR "Hot path functions not inlined in ${ELF}:\n  ${OUT_OF_LINE}")
+endif()
+
+message(STATUS "Hot path inlined")
@@ -0,0 +1,49 @@
+# Copyright (c) 2020 ARM Limited. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+
+# Flash and RAM taken up by an image, and how they compare to a baseline.
+#
+# Run as a script after the build:
+#
+#   cmake -DELF=<image> -DSIZE_TOOL=<arm-none-eabi-size> [-DBASELINE=<file>] -P SizeReport.cmake
+#
+# Flash is text and initialized data, RAM is initialized and zeroed data
+# (the heap and the stacks the RTOS allocates from it not included). The
+# figures are written next to the image as <image>.size, which a build of
+# another profile can then take as its BASELINE.
+
+execute_process(
+    COMMAND ${SIZE_TOOL} ${ELF}
+    OUTPUT_VARIABLE SIZE_OUTPUT
+    RESULT_VARIABLE SIZE_RESULT
+)
+
+if(NOT SIZE_RESULT EQUAL 0)
+    message(WARNING "Size report skipped, ${SIZE_TOOL} failed")
+    return()
+endif()
+
+# Berkeley format: text data bss dec hex filename, after a header line.
+string(REGEX MATCH "\n[ \t]*([0-9]+)[ \t]+([0-9]+)[ \t]+([0-9]+)" SIZE_LINE "${SIZE_OUTPUT}")
+math(EXPR FLASH "${CMAKE_MATCH_1} + ${CMAKE_MATCH_2}")
+math(EXPR RAM "${CMAKE_MATCH_2} + ${CMAKE_MATCH_3}")
+
+file(WRITE ${ELF}.size "set(BASELINE_FLASH ${FLASH})\nset(BASELINE_RAM ${RAM})\n")
+
+if(BASELINE AND EXISTS ${BASELINE})
+    include(${BASELINE})
+    math(EXPR FLASH_DELTA "${FLASH} - ${BASELINE_FLASH}")
+    math(EXPR RAM_DELTA "${RAM} - ${BASELINE_RAM}")
+
+    # A sign for growth as well as for savings.
+    if(FLASH_DELTA GREATER_EQUAL 0)
+        set(FLASH_DELTA "+${FLASH_DELTA}")
+    endif()
+    if(RAM_DELTA GREATER_EQUAL 0)
+        set(RAM_DELTA "+${RAM_DELTA}")
+    endif()
+
+    message(STATUS "Image size: flash ${FLASH} bytes (${FLASH_DELTA}), RAM ${RAM} bytes (${RAM_DELTA}) against ${BASELINE}")
+else()
+    message(STATUS "Image size: flash ${FLASH} bytes, RAM ${RAM} bytes")
+endif()
@@ -0,0 +1,98 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "platform/mbed_assert.h"
+
+// Picks the advertising interval from how often the payload changes.
+//
+// The radio duty cycle, and so the battery life, is set almost entirely
+// by the advertising interval. Scanners only need a short interval while
+// there is something new to see. Whenever the payload changes the interval
+// therefore drops straight to the minimum. For as long as it then stays
+// unchanged, the interval is multiplied by the backoff factor after every
+// run of stable updates, up to the maximum.
+class AdaptiveIntervalScheduler
+{
+public:
+    struct Policy_t
+    {
+        uint32_t m_MinimumIntervalMs;
+        uint32_t m_MaximumIntervalMs;
+        uint8_t  m_BackoffFactor;              // Interval growth per backoff step.
+        uint8_t  m_StableUpdatesBeforeBackoff; // Unchanged updates per backoff step.
+    };
+
+    explicit AdaptiveIntervalScheduler(const Policy_t &policy)
+    {
+        set_policy(policy);
+    }
+
+    /** Replace the policy; the interval restarts from the minimum. */
+    void set_policy(const Policy_t &policy)
+    {
+        MBED_ASSERT((policy.m_MinimumIntervalMs <= policy.m_MaximumIntervalMs)
+                    && (policy.m_BackoffFactor >= 1)
+                    && (policy.m_StableUpdatesBeforeBackoff >= 1));
+
+        m_Policy        = policy;
+        m_IntervalMs    = policy.m_MinimumIntervalMs;
+        m_StableUpdates = 0;
+    }
+
+    const Policy_t & policy() const
+    {
+        return m_Policy;
+    }
+
+    /** Feed one update cycle. Returns the interval to advertise at. */
+    uint32_t on_update(bool payloadChanged)
+    {
+        if (payloadChanged)
+        {
+            m_IntervalMs    = m_Policy.m_MinimumIntervalMs;
+            m_StableUpdates = 0;
+        }
+        else if (++m_StableUpdates >= m_Policy.m_StableUpdatesBeforeBackoff)
+        {
+            m_StableUpdates = 0;
+
+            // Compare before multiplying so that the product cannot wrap.
+            if (m_IntervalMs > m_Policy.m_MaximumIntervalMs / m_Policy.m_BackoffFactor)
+            {
+                m_IntervalMs = m_Policy.m_MaximumIntervalMs;
+            }
+            else
+            {
+                m_IntervalMs *= m_Policy.m_BackoffFactor;
+            }
+        }
+
+        return m_IntervalMs;
+    }
+
+    uint32_t interval_ms() const
+    {
+        return m_IntervalMs;
+    }
+
+private:
+    Policy_t m_Policy;
+    uint32_t m_IntervalMs;
+    uint8_t  m_StableUpdates;
+};
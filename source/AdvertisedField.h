@@ -0,0 +1,261 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include "platform/mbed_assert.h"
+#include "platform/Callback.h"
+#include "platform/Span.h"
+
+// Sensor sources feeding slots of the advertising payloads.
+//
+// Every advertised value has a source that is sampled on its own schedule
+// and an encoder that writes the latest sample into the value's slot of
+// the advertising buffer through an mbed::Span. The slot is the buffer
+// itself, i.e. nothing is staged elsewhere and copied in later. Sampling
+// (possibly slow, I2C or ADC) and encoding (a few stores on the payload
+// update path) are separate steps, so the rate at which sensors are read
+// no longer has to match the rate at which payloads are committed.
+//
+// A value may be advertised in more than one payload, such as the main
+// advertising payload and the periodic advertising train, hence the small
+// number of slots per field.
+
+/** Default encoding: the integral value in little-endian byte order, the
+ *  byte order used throughout the advertising data format. */
+template <typename T>
+struct LittleEndianFieldEncoder
+{
+    static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+                  "LittleEndianFieldEncoder only encodes integral types");
+
+    static constexpr size_t SIZE = sizeof(T);
+
+    static void encode(const T &value, mbed::Span<uint8_t> slot)
+    {
+        typename std::make_unsigned<T>::type bits = value;
+
+        for (size_t i = 0; i < SIZE; ++i)
+        {
+            slot[i] = static_cast<uint8_t>(bits);
+            bits >>= 8;
+        }
+    }
+};
+
+class AdvertisedFieldBase
+{
+public:
+    static constexpr size_t MAX_SLOTS = 2;
+
+    // Upper bound on encoded_size(), for reserving slots ahead of encoding.
+    static constexpr size_t MAX_ENCODED_SIZE = 8;
+
+    virtual ~AdvertisedFieldBase()
+    {
+    }
+
+    /** Read the source. Runs on the sampling schedule. */
+    virtual void sample() = 0;
+
+    /** Write the latest sample into every bound slot. Runs on the payload
+     *  update path and does no more than the encoder's stores. */
+    virtual void encode() = 0;
+
+    /** Number of bytes the encoded value takes up in a payload. */
+    virtual size_t encoded_size() const = 0;
+
+    /** Write the latest sample into destination, which need not be bound,
+     *  e.g. a telemetry record. */
+    virtual void encode_to(mbed::Span<uint8_t> destination) const = 0;
+
+    /** Use slot, a part of an advertising buffer, to advertise the value. */
+    bool bind(mbed::Span<uint8_t> slot)
+    {
+        if ((m_SlotCount == MAX_SLOTS) || (slot.size() < encoded_size()))
+        {
+            return false;
+        }
+
+        m_Slots[m_SlotCount++] = slot;
+        return true;
+    }
+
+    void unbind_all()
+    {
+        m_SlotCount = 0;
+    }
+
+protected:
+    AdvertisedFieldBase()
+        : m_SlotCount(0)
+    {
+    }
+
+    mbed::Span<uint8_t> m_Slots[MAX_SLOTS];
+    size_t              m_SlotCount;
+};
+
+template <typename T, typename Encoder = LittleEndianFieldEncoder<T>>
+class AdvertisedField : public AdvertisedFieldBase
+{
+    static_assert(Encoder::SIZE <= MAX_ENCODED_SIZE, "Encoded field too large for a slot");
+
+public:
+    typedef mbed::Callback<T()> Source_t;
+
+    AdvertisedField(Source_t source, const T &initial = T())
+        : m_Source(source)
+        , m_Latest(initial)
+    {
+    }
+
+    void sample() override
+    {
+        m_Latest = m_Source();
+    }
+
+    void encode() override
+    {
+        for (size_t i = 0; i < m_SlotCount; ++i)
+        {
+            Encoder::encode(m_Latest, m_Slots[i]);
+        }
+    }
+
+    size_t encoded_size() const override
+    {
+        return Encoder::SIZE;
+    }
+
+    void encode_to(mbed::Span<uint8_t> destination) const override
+    {
+        Encoder::encode(m_Latest, destination);
+    }
+
+    const T & latest() const
+    {
+        return m_Latest;
+    }
+
+private:
+    Source_t m_Source;
+    T        m_Latest;
+};
+
+/** Fixed capacity set of fields that are sampled and encoded together,
+ *  each advertised as the data of a 16-bit UUID service data structure. */
+template <size_t Capacity>
+class AdvertisedFieldRegistry
+{
+public:
+    AdvertisedFieldRegistry()
+        : m_Count(0)
+    {
+    }
+
+    bool add(AdvertisedFieldBase &field, uint16_t serviceUuid)
+    {
+        if (m_Count == Capacity)
+        {
+            return false;
+        }
+
+        m_Entries[m_Count].m_Field       = &field;
+        m_Entries[m_Count].m_ServiceUuid = serviceUuid;
+        ++m_Count;
+        return true;
+    }
+
+    void sample_all()
+    {
+        for (size_t i = 0; i < m_Count; ++i)
+        {
+            m_Entries[i].m_Field->sample();
+        }
+    }
+
+    void encode_all()
+    {
+        for (size_t i = 0; i < m_Count; ++i)
+        {
+            m_Entries[i].m_Field->encode();
+        }
+    }
+
+    void unbind_all()
+    {
+        for (size_t i = 0; i < m_Count; ++i)
+        {
+            m_Entries[i].m_Field->unbind_all();
+        }
+    }
+
+    /** The latest samples of all fields, back to back in the order the
+     *  fields were added, encoded into destination. */
+    void encode_to(mbed::Span<uint8_t> destination) const
+    {
+        size_t offset = 0;
+
+        for (size_t i = 0; i < m_Count; ++i)
+        {
+            const AdvertisedFieldBase &field = *m_Entries[i].m_Field;
+
+            field.encode_to(destination.subspan(offset, field.encoded_size()));
+            offset += field.encoded_size();
+        }
+    }
+
+    /** Number of bytes encode_to() writes. */
+    size_t encoded_size() const
+    {
+        size_t total = 0;
+
+        for (size_t i = 0; i < m_Count; ++i)
+        {
+            total += m_Entries[i].m_Field->encoded_size();
+        }
+
+        return total;
+    }
+
+    size_t size() const
+    {
+        return m_Count;
+    }
+
+    AdvertisedFieldBase & field(size_t index) const
+    {
+        return *m_Entries[index].m_Field;
+    }
+
+    uint16_t service_uuid(size_t index) const
+    {
+        return m_Entries[index].m_ServiceUuid;
+    }
+
+private:
+    struct Entry_t
+    {
+        AdvertisedFieldBase * m_Field;
+        uint16_t              m_ServiceUuid;
+    };
+
+    Entry_t m_Entries[Capacity];
+    size_t  m_Count;
+};
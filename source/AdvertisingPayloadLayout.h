@@ -0,0 +1,249 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "ble/BLE.h"
+
+// Advertising payloads laid out at compile time.
+//
+// Once it is known which AD structures make up a payload, and how large
+// each one is, everything else about the payload is known too: its total
+// size, the offset of every structure and the bytes it starts out with.
+// AdvertisingPayloadLayout works all of this out in constant expressions.
+// As a result:
+//
+// - the initial payload is an image in flash, copied into the advertising
+//   buffer as is, with no AdvertisingDataBuilder pass at start up.
+// - every value sits at a fixed offset, so it can be patched without a
+//   search.
+// - a layout that does not fit fails a static_assert and the build,
+//   rather than setServiceData() and friends returning
+//   BLE_ERROR_BUFFER_OVERFLOW at run time.
+//
+// An AD structure is described by a type that provides constexpr static
+// type(), data_size() and data(index) functions, the last returning the
+// initial data bytes.
+
+template <uint8_t Flags>
+struct FlagsStructure
+{
+    static constexpr uint8_t type()
+    {
+        return ble::adv_data_type_t::FLAGS;
+    }
+
+    static constexpr size_t data_size()
+    {
+        return 1;
+    }
+
+    static constexpr uint8_t data(size_t)
+    {
+        return Flags;
+    }
+};
+
+/** The complete local name, Name being a constexpr string literal. */
+template <size_t Length, const char (&Name)[Length]>
+struct CompleteLocalNameStructure
+{
+    static constexpr uint8_t type()
+    {
+        return ble::adv_data_type_t::COMPLETE_LOCAL_NAME;
+    }
+
+    // The terminating null character is not advertised.
+    static constexpr size_t data_size()
+    {
+        return Length - 1;
+    }
+
+    static constexpr uint8_t data(size_t index)
+    {
+        return static_cast<uint8_t>(Name[index]);
+    }
+};
+
+/** A shortened local name made of a constexpr string literal prefix and
+ *  Digits characters that differ from unit to unit, '0' until they are
+ *  filled in at run time. */
+template <size_t Length, const char (&Prefix)[Length], size_t Digits>
+struct UnitNameStructure
+{
+    static constexpr uint8_t type()
+    {
+        return ble::adv_data_type_t::SHORTENED_LOCAL_NAME;
+    }
+
+    static constexpr size_t data_size()
+    {
+        return digits_offset() + Digits;
+    }
+
+    /** Offset of the digits within the data, past the prefix. */
+    static constexpr size_t digits_offset()
+    {
+        return Length - 1;
+    }
+
+    static constexpr uint8_t data(size_t index)
+    {
+        return (index < digits_offset()) ? static_cast<uint8_t>(Prefix[index]) : '0';
+    }
+};
+
+/** Service data for a 16-bit UUID, with a zero-filled value of ValueSize bytes. */
+template <uint16_t Uuid, size_t ValueSize>
+struct ServiceData16Structure
+{
+    static constexpr uint8_t type()
+    {
+        return ble::adv_data_type_t::SERVICE_DATA_16BIT_ID;
+    }
+
+    static constexpr size_t data_size()
+    {
+        return value_offset() + ValueSize;
+    }
+
+    /** Offset of the value within the data, past the little-endian UUID. */
+    static constexpr size_t value_offset()
+    {
+        return sizeof(Uuid);
+    }
+
+    static constexpr uint8_t data(size_t index)
+    {
+        return (index == 0) ? static_cast<uint8_t>(Uuid)
+             : (index == 1) ? static_cast<uint8_t>(Uuid >> 8)
+             : 0;
+    }
+};
+
+/** Any AD structure whose data is known in full at compile time. */
+template <uint8_t Type, uint8_t... Bytes>
+struct AdvertisingStructure
+{
+    static constexpr uint8_t type()
+    {
+        return Type;
+    }
+
+    static constexpr size_t data_size()
+    {
+        return sizeof...(Bytes);
+    }
+
+    static constexpr uint8_t data(size_t index)
+    {
+        const uint8_t bytes[] = { Bytes... };
+        return bytes[index];
+    }
+};
+
+template <uint8_t... Bytes>
+using ManufacturerSpecificDataStructure = AdvertisingStructure<ble::adv_data_type_t::MANUFACTURER_SPECIFIC_DATA, Bytes...>;
+
+namespace detail
+{
+    // Byte at position within the concatenation of Structures.
+    template <typename... Structures>
+    struct AdvertisingStructureBytes;
+
+    template <>
+    struct AdvertisingStructureBytes<>
+    {
+        static constexpr uint8_t at(size_t)
+        {
+            return 0;
+        }
+    };
+
+    template <typename First, typename... Rest>
+    struct AdvertisingStructureBytes<First, Rest...>
+    {
+        // The length byte counts the type byte and the data.
+        static_assert(First::data_size() <= 254, "AD structure data too large");
+
+        static constexpr uint8_t at(size_t position)
+        {
+            return (position == 0)                       ? static_cast<uint8_t>(1 + First::data_size())
+                 : (position == 1)                       ? First::type()
+                 : (position < 2 + First::data_size())   ? First::data(position - 2)
+                 : AdvertisingStructureBytes<Rest...>::at(position - (2 + First::data_size()));
+        }
+    };
+}
+
+template <typename... Structures>
+class AdvertisingPayloadLayout
+{
+public:
+    /** Number of bytes the whole payload takes up. */
+    static constexpr size_t size()
+    {
+        return offset(sizeof...(Structures));
+    }
+
+    /** Offset of the length byte of the index-th structure. */
+    static constexpr size_t offset(size_t index)
+    {
+        const size_t sizes[] = { (2 + Structures::data_size())..., 0 };
+
+        size_t result = 0;
+        for (size_t i = 0; i < index; ++i)
+        {
+            result += sizes[i];
+        }
+
+        return result;
+    }
+
+    /** Offset of the data of the index-th structure. */
+    static constexpr size_t data_offset(size_t index)
+    {
+        return offset(index) + 2;
+    }
+
+    static constexpr uint8_t byte(size_t position)
+    {
+        return detail::AdvertisingStructureBytes<Structures...>::at(position);
+    }
+};
+
+template <size_t Size>
+struct AdvertisingPayloadImage_t
+{
+    uint8_t m_Bytes[Size];
+};
+
+/** The initial bytes of a payload with the given layout. Meant for
+ *  initializing a constexpr object, which then lives in flash. */
+template <typename Layout>
+constexpr AdvertisingPayloadImage_t<Layout::size()> make_advertising_payload_image()
+{
+    AdvertisingPayloadImage_t<Layout::size()> image = {};
+
+    for (size_t i = 0; i < Layout::size(); ++i)
+    {
+        image.m_Bytes[i] = Layout::byte(i);
+    }
+
+    return image;
+}
@@ -0,0 +1,181 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "platform/Span.h"
+
+// Advertising reports already seen, for dropping repeats.
+//
+// A scanner in a dense deployment gets thousands of reports a second, and
+// nearly all of them repeat the payload it last had from the same peer.
+// Each peer, by address and address type, has an entry holding a hash of
+// its latest payload, in a fixed table of Capacity entries with open
+// addressing and linear probing. A report whose hash matches its peer's
+// entry is a duplicate. Any other payload is a change, even back to one
+// the peer sent before, and replaces the hash. A peer not in the table is
+// remembered in the first free entry of its probe sequence; when the
+// sequence has none, the entry looked up longest ago in it gives way.
+// Either way a report costs no more than MAX_PROBES short compares and
+// never touches the heap.
+//
+// Peers rotating through a few payloads (beacon frames, say) thus have
+// every frame forwarded, each being a change from the one before.
+//
+// The payload hash is 32-bit FNV-1a. A change to a payload with the same
+// hash goes unnoticed until the next change; with 32 bits that is rare
+// enough not to be worth storing the payloads themselves.
+template <size_t Capacity>
+class AdvertisingReportCache
+{
+    static_assert((Capacity > 0) && ((Capacity & (Capacity - 1)) == 0),
+                  "AdvertisingReportCache capacity must be a power of two");
+
+public:
+    static constexpr size_t ADDRESS_SIZE = 6;
+
+    // Longest probe sequence, hence the work bound per report.
+    static constexpr size_t MAX_PROBES = (Capacity < 8) ? Capacity : 8;
+
+    AdvertisingReportCache()
+        : m_Entries()
+        , m_Clock(0)
+        , m_Lookups(0)
+        , m_Duplicates(0)
+        , m_Evictions(0)
+    {
+    }
+
+    /** Look up a report. Returns false if it repeats the latest payload of
+     *  its peer; true if it is new, in which case it is the peer's latest
+     *  payload from now on. */
+    bool insert(const uint8_t *address, uint8_t addressType, mbed::Span<const uint8_t> payload)
+    {
+        const uint32_t payloadHash = fnv1a(FNV_OFFSET_BASIS, payload.data(), payload.size());
+        const uint32_t key         = fnv1a(fnv1a(FNV_OFFSET_BASIS, address, ADDRESS_SIZE), &addressType, 1);
+
+        /* stamp 0 marks an empty entry, so the clock skips it on wrap */
+        if (++m_Clock == 0)
+        {
+            m_Clock = 1;
+        }
+
+        ++m_Lookups;
+
+        Entry_t *victim = nullptr;
+        size_t   slot   = mix(key) & (Capacity - 1);
+
+        for (size_t probe = 0; probe < MAX_PROBES; ++probe, slot = (slot + 1) & (Capacity - 1))
+        {
+            Entry_t &entry = m_Entries[slot];
+
+            if (entry.m_Stamp == 0)
+            {
+                victim = &entry;
+                break;
+            }
+
+            if ((entry.m_AddressType == addressType)
+                && (std::memcmp(entry.m_Address, address, ADDRESS_SIZE) == 0))
+            {
+                entry.m_Stamp = m_Clock;
+
+                if (entry.m_PayloadHash == payloadHash)
+                {
+                    ++m_Duplicates;
+                    return false;
+                }
+
+                entry.m_PayloadHash = payloadHash;
+                return true;
+            }
+
+            /* unsigned differences keep the oldest right across a wrap */
+            if (!victim || ((m_Clock - entry.m_Stamp) > (m_Clock - victim->m_Stamp)))
+            {
+                victim = &entry;
+            }
+        }
+
+        if (victim->m_Stamp != 0)
+        {
+            ++m_Evictions;
+        }
+
+        std::memcpy(victim->m_Address, address, ADDRESS_SIZE);
+        victim->m_AddressType = addressType;
+        victim->m_PayloadHash = payloadHash;
+        victim->m_Stamp       = m_Clock;
+
+        return true;
+    }
+
+    uint32_t lookups() const
+    {
+        return m_Lookups;
+    }
+
+    uint32_t duplicates() const
+    {
+        return m_Duplicates;
+    }
+
+    /** Entries that gave way to a new one while still in use. */
+    uint32_t evictions() const
+    {
+        return m_Evictions;
+    }
+
+private:
+    static constexpr uint32_t FNV_OFFSET_BASIS = 2166136261UL;
+    static constexpr uint32_t FNV_PRIME        = 16777619UL;
+
+    struct Entry_t
+    {
+        uint32_t m_PayloadHash;
+        uint32_t m_Stamp;
+        uint8_t  m_Address[ADDRESS_SIZE];
+        uint8_t  m_AddressType;
+    };
+
+    static uint32_t fnv1a(uint32_t hash, const uint8_t *bytes, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ bytes[i]) * FNV_PRIME;
+        }
+
+        return hash;
+    }
+
+    /** Spread the key over the table, FNV-1a leaving runs in the low bits
+     *  for keys that differ little. */
+    static uint32_t mix(uint32_t key)
+    {
+        key ^= key >> 16;
+        key *= 0x7FEB352DUL;
+        key ^= key >> 15;
+        return key;
+    }
+
+    Entry_t  m_Entries[Capacity];
+    uint32_t m_Clock;
+    uint32_t m_Lookups;
+    uint32_t m_Duplicates;
+    uint32_t m_Evictions;
+};
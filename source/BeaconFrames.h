@@ -0,0 +1,184 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "platform/Span.h"
+#include "AdvertisingPayloadLayout.h"
+#include "HealthCounters.h"
+
+// Frames of the third party beacon formats, each a legacy advertising
+// payload laid out at compile time.
+//
+// Scanners look for these formats:
+//
+// - iBeacon: Apple manufacturer data with a proximity UUID, major, minor
+//   and the measured power at 1 m.
+// - Eddystone-UID: Eddystone service data with a 10 byte namespace, a
+//   6 byte instance and the transmit power at 0 m.
+// - Eddystone-TLM: Eddystone service data with battery voltage,
+//   temperature, advertising PDU count and time since boot. It is meant to
+//   be interleaved with a UID frame.
+//
+// With app.health-counters there is one more, of this application's own:
+//
+// - Diagnostics: manufacturer data behind the company identifier of the
+//   application payload, frame type 0xD1, followed by the health counters,
+//   little-endian: payload writes taken (32 bits), refused with
+//   BLE_STACK_BUSY, with BLE_ERROR_NO_MEM and with any other error (16
+//   bits each, saturating), advertising events and scan requests (32
+//   bits each), events pending on the queue and their peak, and the CPU
+//   idle percentage (8 bits each, 0xFF when not known).
+//
+// iBeacon and UID never change and go out straight from flash. TLM and
+// diagnostics start from their images and are patched in place before
+// every time they are sent.
+enum BeaconFormat_t
+{
+    BEACON_FORMAT_CUSTOM,          // The application's own payload.
+    BEACON_FORMAT_IBEACON,
+    BEACON_FORMAT_EDDYSTONE_UID,
+    BEACON_FORMAT_EDDYSTONE_TLM,
+    BEACON_FORMAT_DIAGNOSTICS,
+    BEACON_FORMAT_COUNT
+};
+
+using BeaconFlags_t = FlagsStructure<ble::adv_data_flags_t::LE_GENERAL_DISCOVERABLE
+                                     | ble::adv_data_flags_t::BREDR_NOT_SUPPORTED>;
+
+using IBeaconLayout_t = AdvertisingPayloadLayout<
+    BeaconFlags_t,
+    ManufacturerSpecificDataStructure<
+        0x4C, 0x00,                 // Apple company identifier.
+        0x02, 0x15,                 // iBeacon type, 21 bytes to follow.
+        MBED_CONF_APP_IBEACON_UUID,
+        static_cast<uint8_t>(MBED_CONF_APP_IBEACON_MAJOR >> 8), static_cast<uint8_t>(MBED_CONF_APP_IBEACON_MAJOR),
+        static_cast<uint8_t>(MBED_CONF_APP_IBEACON_MINOR >> 8), static_cast<uint8_t>(MBED_CONF_APP_IBEACON_MINOR),
+        static_cast<uint8_t>(MBED_CONF_APP_IBEACON_MEASURED_POWER)
+    >
+>;
+
+// Both Eddystone frames list the Eddystone service and carry its data.
+using EddystoneServiceList_t = AdvertisingStructure<ble::adv_data_type_t::COMPLETE_LIST_16BIT_SERVICE_IDS, 0xAA, 0xFE>;
+
+using EddystoneUidLayout_t = AdvertisingPayloadLayout<
+    BeaconFlags_t,
+    EddystoneServiceList_t,
+    AdvertisingStructure<
+        ble::adv_data_type_t::SERVICE_DATA_16BIT_ID,
+        0xAA, 0xFE,                 // Eddystone service UUID.
+        0x00,                       // UID frame.
+        static_cast<uint8_t>(MBED_CONF_APP_EDDYSTONE_TX_POWER),
+        MBED_CONF_APP_EDDYSTONE_NAMESPACE,
+        MBED_CONF_APP_EDDYSTONE_INSTANCE,
+        0x00, 0x00                  // Reserved.
+    >
+>;
+
+using EddystoneTlmLayout_t = AdvertisingPayloadLayout<
+    BeaconFlags_t,
+    EddystoneServiceList_t,
+    AdvertisingStructure<
+        ble::adv_data_type_t::SERVICE_DATA_16BIT_ID,
+        0xAA, 0xFE,                 // Eddystone service UUID.
+        0x20, 0x00,                 // Unencrypted TLM frame, version 0.
+        0x00, 0x00,                 // Battery voltage, mV.
+        0x80, 0x00,                 // Temperature, 8.8 fixed point; -128 C means not supported.
+        0x00, 0x00, 0x00, 0x00,     // Advertising PDU count.
+        0x00, 0x00, 0x00, 0x00      // Time since boot, 0.1 s.
+    >
+>;
+
+using DiagnosticsLayout_t = AdvertisingPayloadLayout<
+    BeaconFlags_t,
+    ManufacturerSpecificDataStructure<
+        0xAD, 0xDE,                 // Company identifier of the application payload.
+        0xD1,                       // Diagnostics frame.
+        0x00, 0x00, 0x00, 0x00,     // Payload writes taken.
+        0x00, 0x00,                 // Refused with BLE_STACK_BUSY.
+        0x00, 0x00,                 // Refused with BLE_ERROR_NO_MEM.
+        0x00, 0x00,                 // Refused otherwise.
+        0x00, 0x00, 0x00, 0x00,     // Advertising events.
+        0x00, 0x00, 0x00, 0x00,     // Scan requests.
+        0xFF, 0xFF,                 // Events pending, peak.
+        0xFF                        // CPU idle, %.
+    >
+>;
+
+static_assert(IBeaconLayout_t::size() <= ble::LEGACY_ADVERTISING_MAX_SIZE, "iBeacon frame does not fit in 31 bytes");
+static_assert(EddystoneUidLayout_t::size() <= ble::LEGACY_ADVERTISING_MAX_SIZE,
+              "Eddystone-UID frame does not fit in 31 bytes, check app.eddystone-namespace and app.eddystone-instance");
+static_assert(EddystoneTlmLayout_t::size() <= ble::LEGACY_ADVERTISING_MAX_SIZE, "Eddystone-TLM frame does not fit in 31 bytes");
+static_assert(DiagnosticsLayout_t::size() <= ble::LEGACY_ADVERTISING_MAX_SIZE, "Diagnostics frame does not fit in 31 bytes");
+
+constexpr auto gs_IBeaconImage       = make_advertising_payload_image<IBeaconLayout_t>();
+constexpr auto gs_EddystoneUidImage  = make_advertising_payload_image<EddystoneUidLayout_t>();
+constexpr auto gs_EddystoneTlmImage  = make_advertising_payload_image<EddystoneTlmLayout_t>();
+constexpr auto gs_DiagnosticsImage   = make_advertising_payload_image<DiagnosticsLayout_t>();
+
+/** Write the telemetry into an Eddystone-TLM frame initialized from
+ *  gs_EddystoneTlmImage. Eddystone fields are big-endian. */
+inline void encode_eddystone_tlm(mbed::Span<uint8_t> frame,
+                                 uint16_t batteryMv,
+                                 uint32_t advertisingCount,
+                                 uint32_t uptimeTenthsOfSecond)
+{
+    // Past the service UUID, frame type and version.
+    constexpr size_t BATTERY_OFFSET = EddystoneTlmLayout_t::data_offset(2) + 4;
+    constexpr size_t COUNT_OFFSET   = BATTERY_OFFSET + 4;
+    constexpr size_t UPTIME_OFFSET  = COUNT_OFFSET + 4;
+
+    frame[BATTERY_OFFSET]     = static_cast<uint8_t>(batteryMv >> 8);
+    frame[BATTERY_OFFSET + 1] = static_cast<uint8_t>(batteryMv);
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        frame[COUNT_OFFSET + i]  = static_cast<uint8_t>(advertisingCount >> (24 - 8 * i));
+        frame[UPTIME_OFFSET + i] = static_cast<uint8_t>(uptimeTenthsOfSecond >> (24 - 8 * i));
+    }
+}
+
+/** Write the reading into a diagnostics frame initialized from
+ *  gs_DiagnosticsImage. */
+inline void encode_diagnostics(mbed::Span<uint8_t> frame, const DiagnosticsReading_t &reading)
+{
+    // Past the company identifier and frame type.
+    size_t offset = DiagnosticsLayout_t::data_offset(1) + 3;
+
+    auto put = [&frame, &offset](uint32_t value, size_t size)
+               {
+                   for (size_t i = 0; i < size; ++i)
+                   {
+                       frame[offset++] = static_cast<uint8_t>(value >> (8 * i));
+                   }
+               };
+
+    auto saturated = [](uint32_t value) -> uint32_t
+                     {
+                         return (value < 0xFFFF) ? value : 0xFFFF;
+                     };
+
+    put(reading.m_PayloadCommits, 4);
+    put(saturated(reading.m_StackBusy), 2);
+    put(saturated(reading.m_NoMemory), 2);
+    put(saturated(reading.m_OtherFailures), 2);
+    put(reading.m_AdvertisingEvents, 4);
+    put(reading.m_ScanRequests, 4);
+    put(reading.m_EventsPending, 1);
+    put(reading.m_EventsPendingPeak, 1);
+    put(reading.m_CpuIdlePercent, 1);
+}
@@ -0,0 +1,2619 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstring>
+#include <chrono>
+#include <events/mbed_events.h>
+#include "ble/BLE.h"
+#include "ble/Gap.h"
+
+// FYI, issue "mbed deploy" at either the top directory (../mbed-os-example-ble)
+// or the particular example directory to have all these peripherally
+// dependent files such as the below, be included in the project.
+#include "pretty_printer.h"
+
+#include "rtos/Kernel.h"
+#include "platform/Callback.h"
+#include "platform/Span.h"
+
+#include "PatchableAdvertisingField.h"
+#include "CommittedPayloadShadow.h"
+#include "AdaptiveIntervalScheduler.h"
+#include "InstrumentedEventQueue.h"
+#include "CycleProfiler.h"
+#include "DeferredLog.h"
+#include "AdvertisedField.h"
+#include "AdvertisingPayloadLayout.h"
+#if MBED_CONF_APP_BEACON_ROTATION
+#include "BeaconFrames.h"
+#endif
+#if MBED_CONF_APP_BOOT_TIME_REPORT
+#include "BootTimeRecord.h"
+#endif
+#if MBED_CONF_APP_CONNECTABLE
+#include "TelemetryGattServer.h"
+#include "ConnectionEventScheduler.h"
+#endif
+#if MBED_CONF_APP_OBSERVER
+#include "AdvertisingReportCache.h"
+#endif
+#if MBED_CONF_APP_PRIVACY && MBED_CONF_APP_UNIT_NAME
+#include "PrivateUnitIdRotation.h"
+#endif
+#if MBED_CONF_APP_COMPACT_TELEMETRY
+#include "CompactTelemetryCodec.h"
+#endif
+#if MBED_CONF_APP_DMA_SAMPLING
+#include "DoubleBufferedAdcSampler.h"
+#include "VbatAdcDma.h"
+#endif
+#if MBED_CONF_APP_HEALTH_COUNTERS
+#include "platform/mbed_stats.h"
+#include "HealthCounters.h"
+#endif
+#if MBED_CONF_APP_CONNECTABLE || MBED_CONF_APP_THROUGHPUT_BENCHMARK || (MBED_CONF_APP_PRIVACY && MBED_CONF_APP_UNIT_NAME)
+#include "hal/us_ticker_api.h"
+#endif
+#if MBED_CONF_APP_THROUGHPUT_BENCHMARK
+#include "ThroughputBenchmark.h"
+#endif
+
+constexpr char DEVICE_NAME[] = "NUCLEO-WB55RG";
+
+#if MBED_CONF_APP_UNIT_NAME
+// Every unit advertises a name of its own, in place of DEVICE_NAME: a
+// prefix common to the fleet followed by the lower three bytes of the
+// unit's address in hex, e.g. "WB1A2B3C". It is put together once at
+// start up. It sits at a fixed offset of the legacy payload, so a scanner
+// picks out a unit with a single compare, and being short it leaves more
+// of the 31 bytes for telemetry. With app.privacy the digits are random
+// instead, and renewed every app.privacy-rotation-interval-s.
+constexpr char UNIT_NAME_PREFIX[] = MBED_CONF_APP_UNIT_NAME_PREFIX;
+constexpr size_t UNIT_ID_DIGITS = 6;
+
+using NameStructure_t = UnitNameStructure<sizeof(UNIT_NAME_PREFIX), UNIT_NAME_PREFIX, UNIT_ID_DIGITS>;
+#else
+using NameStructure_t = CompleteLocalNameStructure<sizeof(DEVICE_NAME), DEVICE_NAME>;
+#endif
+
+// Advertising features compiled in: asked for by the application
+// configuration and available in the BLE API build.
+#define EXTENDED_ADVERTISING_ENABLED (MBED_CONF_APP_EXTENDED_ADVERTISING && BLE_FEATURE_EXTENDED_ADVERTISING)
+#define PERIODIC_ADVERTISING_ENABLED (MBED_CONF_APP_PERIODIC_ADVERTISING && BLE_FEATURE_PERIODIC_ADVERTISING)
+
+// With privacy, a unit name carries an ID of its own that is rotated, see
+// PrivateUnitIdRotation, rather than one derived from the address.
+#define PRIVATE_UNIT_ID_ENABLED (MBED_CONF_APP_PRIVACY && MBED_CONF_APP_UNIT_NAME)
+
+// The beacon formats rotated through. The iBeacon and Eddystone-UID frames
+// carry fixed identifiers, which would track the unit across private
+// addresses, so privacy leaves them out.
+#if MBED_CONF_APP_PRIVACY
+#define BEACON_ROTATION_FORMATS (MBED_CONF_APP_BEACON_ROTATION_FORMATS & ~0x06)
+#else
+#define BEACON_ROTATION_FORMATS (MBED_CONF_APP_BEACON_ROTATION_FORMATS)
+#endif
+
+#if MBED_CONF_APP_PERIODIC_ADVERTISING && !MBED_CONF_APP_EXTENDED_ADVERTISING
+#error "app.periodic-advertising runs on the extended advertising set and requires app.extended-advertising"
+#endif
+
+#if MBED_CONF_APP_CONNECTABLE && MBED_CONF_APP_PERIODIC_ADVERTISING
+#error "app.periodic-advertising needs a non-connectable advertising set and cannot be combined with app.connectable"
+#endif
+
+#if MBED_CONF_APP_PRIVACY && !(BLE_FEATURE_PRIVACY && BLE_FEATURE_SECURITY)
+#error "app.privacy requires the privacy and security features of the BLE API, ble.ble-feature-privacy and ble.ble-feature-security"
+#endif
+
+// The rotation latency is measured on the 32-bit microsecond ticker.
+#if PRIVATE_UNIT_ID_ENABLED \
+    && ((MBED_CONF_APP_PRIVACY_ROTATION_INTERVAL_S < 1) || (MBED_CONF_APP_PRIVACY_ROTATION_INTERVAL_S > 4294))
+#error "app.privacy-rotation-interval-s must be between 1 and 4294 seconds"
+#endif
+
+#if MBED_CONF_APP_OBSERVER && (MBED_CONF_APP_OBSERVER_SCAN_WINDOW_MS > MBED_CONF_APP_OBSERVER_SCAN_INTERVAL_MS)
+#error "app.observer-scan-window-ms cannot be longer than app.observer-scan-interval-ms"
+#endif
+
+#if MBED_CONF_APP_THROUGHPUT_BENCHMARK \
+    && ((MBED_CONF_APP_THROUGHPUT_BENCHMARK_MIN_INTERVAL_MS == 0) \
+        || (MBED_CONF_APP_THROUGHPUT_BENCHMARK_START_INTERVAL_MS < MBED_CONF_APP_THROUGHPUT_BENCHMARK_MIN_INTERVAL_MS))
+#error "app.throughput-benchmark-start-interval-ms must be at least app.throughput-benchmark-min-interval-ms, which must not be 0"
+#endif
+
+#if MBED_CONF_APP_DMA_SAMPLING && ((MBED_CONF_APP_DMA_SAMPLING_BLOCK_SIZE < 1) || (MBED_CONF_APP_DMA_SAMPLING_BLOCK_SIZE > 256))
+#error "app.dma-sampling-block-size must be between 1 and 256 samples"
+#endif
+
+#if MBED_CONF_APP_BEACON_ROTATION && ((MBED_CONF_APP_BEACON_ROTATION_FORMATS & 0x1F) == 0)
+#error "app.beacon-rotation-formats must enable at least one beacon format"
+#endif
+
+#if MBED_CONF_APP_BEACON_ROTATION && MBED_CONF_APP_PRIVACY && ((BEACON_ROTATION_FORMATS & 0x1F) == 0)
+#error "app.privacy leaves out the iBeacon and Eddystone-UID formats, app.beacon-rotation-formats must enable another"
+#endif
+
+#if MBED_CONF_APP_BEACON_ROTATION && (BEACON_ROTATION_FORMATS & 0x10) && !MBED_CONF_APP_HEALTH_COUNTERS
+#error "The diagnostics beacon format, 0x10 in app.beacon-rotation-formats, carries the counters of app.health-counters"
+#endif
+
+#if MBED_CONF_APP_HEALTH_COUNTERS && !MBED_CPU_STATS_ENABLED
+#error "app.health-counters reads the CPU statistics and requires platform.cpu-stats-enabled"
+#endif
+
+#if MBED_CONF_APP_HEALTH_COUNTERS && (MBED_CONF_APP_HEALTH_REPORT_INTERVAL_MS == 0)
+#error "app.health-report-interval-ms must not be 0, the CPU idle share is measured over it"
+#endif
+
+// The diagnostics frame is sent as one of the rotating beacon formats.
+#define DIAGNOSTICS_FRAME_ENABLED (MBED_CONF_APP_BEACON_ROTATION && MBED_CONF_APP_HEALTH_COUNTERS)
+
+// Legacy advertising PDUs carry at most 31 bytes of data. Extended
+// advertising sets can carry far more, so when that mode is compiled in
+// the buffer is sized for it and the builder is simply handed the legacy
+// limit should the controller turn out to lack the feature.
+#if MBED_CONF_APP_EXTENDED_ADVERTISING
+constexpr size_t ADVERTISING_BUFFER_SIZE = MBED_CONF_APP_EXTENDED_ADVERTISING_MAX_SIZE;
+#else
+constexpr size_t ADVERTISING_BUFFER_SIZE = ble::LEGACY_ADVERTISING_MAX_SIZE;
+#endif
+
+// AdvertisingDataBuilder keeps the payload length in a single byte.
+static_assert((ADVERTISING_BUFFER_SIZE >= ble::LEGACY_ADVERTISING_MAX_SIZE)
+              && (ADVERTISING_BUFFER_SIZE <= 255),
+              "app.extended-advertising-max-size must be between 31 and 255 bytes");
+
+// The legacy payloads are fixed apart from the value of the battery level,
+// so their layouts are worked out at compile time. Their images live in
+// flash and are copied into place as is, and a name or field that makes
+// them outgrow a legacy PDU breaks the build rather than the advertising.
+using VendorSpecificData_t = ManufacturerSpecificDataStructure<0xAD, 0xDE, 0xBE, 0xEF>;
+
+using LegacyAdvertisingLayout_t = AdvertisingPayloadLayout<
+    FlagsStructure<ble::adv_data_flags_t::LE_GENERAL_DISCOVERABLE | ble::adv_data_flags_t::BREDR_NOT_SUPPORTED>,
+    NameStructure_t,
+    ServiceData16Structure<GattService::UUID_BATTERY_SERVICE, sizeof(uint8_t)>
+>;
+
+using LegacyScanResponseLayout_t = AdvertisingPayloadLayout<VendorSpecificData_t>;
+
+static_assert(LegacyAdvertisingLayout_t::size() <= ble::LEGACY_ADVERTISING_MAX_SIZE,
+              "The legacy advertising payload does not fit in 31 bytes, shorten DEVICE_NAME or app.unit-name-prefix");
+static_assert(LegacyScanResponseLayout_t::size() <= ble::LEGACY_ADVERTISING_MAX_SIZE,
+              "The legacy scan response does not fit in 31 bytes");
+
+#if MBED_CONF_APP_COMPACT_TELEMETRY
+// The compact telemetry frames take the place of the vendor specific data
+// in the scan response, behind the same company identifier.
+constexpr size_t COMPACT_TELEMETRY_COMPANY_ID_SIZE = 2;
+constexpr size_t COMPACT_TELEMETRY_FRAME_SIZE = ble::LEGACY_ADVERTISING_MAX_SIZE - 2 - COMPACT_TELEMETRY_COMPANY_ID_SIZE;
+
+using CompactTelemetryEncoder_t = CompactTelemetryEncoder<MBED_CONF_APP_COMPACT_TELEMETRY_MAX_CHANNELS,
+                                                          MBED_CONF_APP_COMPACT_TELEMETRY_KEYFRAME_INTERVAL>;
+#endif
+
+#if MBED_CONF_APP_DMA_SAMPLING
+// The battery voltage, sampled by DMA into two blocks and handed over
+// filtered; see DoubleBufferedAdcSampler.
+using BatterySampler_t = DoubleBufferedAdcSampler<MBED_CONF_APP_DMA_SAMPLING_BLOCK_SIZE,
+                                                  MBED_CONF_APP_DMA_SAMPLING_FILTER_SHIFT>;
+using BatteryAdc_t = VbatAdcDma<BatterySampler_t>;
+#endif
+
+constexpr auto gs_LegacyAdvertisingImage  = make_advertising_payload_image<LegacyAdvertisingLayout_t>();
+constexpr auto gs_LegacyScanResponseImage = make_advertising_payload_image<LegacyScanResponseLayout_t>();
+
+// The legacy layout holds the battery level and no other advertised field,
+// its byte following the UUID of the third structure.
+constexpr size_t LEGACY_LAYOUT_ADVERTISED_FIELDS = 1;
+constexpr size_t LEGACY_BATTERY_LEVEL_OFFSET = LegacyAdvertisingLayout_t::data_offset(2)
+    + ServiceData16Structure<GattService::UUID_BATTERY_SERVICE, sizeof(uint8_t)>::value_offset();
+
+#if MBED_CONF_APP_UNIT_NAME
+constexpr size_t LEGACY_UNIT_ID_OFFSET = LegacyAdvertisingLayout_t::data_offset(1) + NameStructure_t::digits_offset();
+#endif
+
+#if PERIODIC_ADVERTISING_ENABLED
+// One LE Set Periodic Advertising Data command carries up to 252 bytes.
+constexpr size_t PERIODIC_ADVERTISING_BUFFER_SIZE = MBED_CONF_APP_PERIODIC_ADVERTISING_MAX_SIZE;
+
+static_assert(PERIODIC_ADVERTISING_BUFFER_SIZE <= 252,
+              "app.periodic-advertising-max-size must not exceed 252 bytes");
+#endif
+
+// The error descriptions live in a constexpr table that the linker places
+// in flash. Nothing is constructed during static initialization and
+// ToString() merely hands back a pointer into that table, so error paths
+// never touch the heap. The table is laid out in ble_error_t order which
+// lets ToString() index it directly; the static_assert below keeps it so.
+struct ErrorCodeEntry_t
+{
+    ble_error_t  m_Code;
+    const char * m_Description;
+};
+
+constexpr ErrorCodeEntry_t gs_ErrorCodesTable[] =
+{
+    { BLE_ERROR_NONE,                      "\"No error\"" },
+    { BLE_ERROR_BUFFER_OVERFLOW,           "\"The requested action would cause a buffer overflow and has been aborted\"" },
+    { BLE_ERROR_NOT_IMPLEMENTED,           "\"Requested a feature that isn't yet implemented or isn't supported by the target HW\"" },
+    { BLE_ERROR_PARAM_OUT_OF_RANGE,        "\"One of the supplied parameters is outside the valid range\"" },
+    { BLE_ERROR_INVALID_PARAM,             "\"One of the supplied parameters is invalid\"" },
+    { BLE_STACK_BUSY,                      "\"The stack is busy\"" },
+    { BLE_ERROR_INVALID_STATE,             "\"Invalid state\"" },
+    { BLE_ERROR_NO_MEM,                    "\"Out of memory\"" },
+    { BLE_ERROR_OPERATION_NOT_PERMITTED,   "\"The operation requested is not permitted\"" },
+    { BLE_ERROR_INITIALIZATION_INCOMPLETE, "\"The BLE subsystem has not completed its initialization\"" },
+    { BLE_ERROR_ALREADY_INITIALIZED,       "\"The BLE system has already been initialized\"" },
+    { BLE_ERROR_UNSPECIFIED,               "\"Unknown error\"" },
+    { BLE_ERROR_INTERNAL_STACK_FAILURE,    "\"The platform-specific stack failed\"" },
+    { BLE_ERROR_NOT_FOUND,                 "\"Data not found or there is nothing to return\"" }
+};
+
+constexpr size_t ERROR_CODES_TABLE_SIZE = sizeof(gs_ErrorCodesTable) / sizeof(gs_ErrorCodesTable[0]);
+
+constexpr bool is_error_codes_table_indexable()
+{
+    for (size_t i = 0; i < ERROR_CODES_TABLE_SIZE; ++i)
+    {
+        if (static_cast<size_t>(gs_ErrorCodesTable[i].m_Code) != i)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(is_error_codes_table_indexable(),
+              "gs_ErrorCodesTable must be ordered by ble_error_t value with no gaps");
+
+constexpr const char * ToString(const ble_error_t & key)
+{
+    // Guard against codes that are not errors at all rather than
+    // indexing past the end of the table.
+    return (static_cast<size_t>(key) < ERROR_CODES_TABLE_SIZE)
+           ? gs_ErrorCodesTable[static_cast<size_t>(key)].m_Description
+           : "\"Warning! Code does not indicate an error and consequently does not exist in gs_ErrorCodesTable!\"";
+}
+
+#if MBED_CONF_APP_HEALTH_COUNTERS
+// The payload write failures are counted per entry of the table.
+using HealthCounters_t = HealthCounters<ERROR_CODES_TABLE_SIZE>;
+#endif
+
+// With app.event-queue-instrumentation the queues count allocation
+// failures, their peak occupancy and dispatch latency, which is what the
+// sizes below should be tuned from. Their events are larger for it, and
+// queue buffers are sized in EVENT_QUEUE_EVENT_SIZE rather than
+// EVENTS_EVENT_SIZE.
+#if MBED_CONF_APP_EVENT_QUEUE_INSTRUMENTATION
+using EventQueue_t = InstrumentedEventQueue;
+#define EVENT_QUEUE_EVENT_SIZE (EVENTS_EVENT_SIZE + InstrumentedEventQueue::EVENT_OVERHEAD)
+#else
+using EventQueue_t = PlainEventQueue;
+#define EVENT_QUEUE_EVENT_SIZE EVENTS_EVENT_SIZE
+#endif
+
+// GAP
+//
+// GAP is an acronym for the Generic Access Profile, and it controls 
+// connections and advertising in Bluetooth. GAP is what makes your device
+// visible to the outside world, and determines how two devices can (or can't)
+// interact with each other.
+class BluetoothLowEnergyEncapsulation : ble::Gap::EventHandler
+{
+    // The host benchmarks (benchmark/host) time the payload path directly.
+    friend class BluetoothLowEnergyEncapsulationBenchmark;
+
+public:
+    BluetoothLowEnergyEncapsulation(BLE &ble, EventQueue_t &event_queue) 
+        : m_BluetoothLowEnergyStack(ble)
+        , m_SharedEventQueue(event_queue)
+        , m_TheBatteryLevel(50)
+#if MBED_CONF_APP_DMA_SAMPLING
+        , m_BatteryLevel(mbed::callback(this, &BluetoothLowEnergyEncapsulation::sampled_battery_level),
+                         m_TheBatteryLevel)
+#else
+        , m_BatteryLevel(mbed::callback(this, &BluetoothLowEnergyEncapsulation::simulate_battery_level),
+                         m_TheBatteryLevel)
+#endif
+        , m_AdvertisingHandle(ble::LEGACY_ADVERTISING_HANDLE)
+        , m_ExtendedAdvertising(false)
+        // Deliberately omitting m_AdvertisingBuffer here so that the implicit
+        // zero-initialization specified during declaration can kick in here.
+        , m_AdvertisingDataBuilder(m_AdvertisingBuffer, ble::LEGACY_ADVERTISING_MAX_SIZE)
+        , m_AdvertisingPayload()
+        , m_ScanResponseDataBuilder(m_ScanResponseBuffer)
+        , m_ScanResponse(gs_LegacyScanResponseImage.m_Bytes)
+        , m_MinimumCommitInterval(MBED_CONF_APP_MIN_PAYLOAD_COMMIT_INTERVAL_MS)
+        , m_LastCommitTime()
+        , m_DeferredCommitPending(false)
+        , m_CommitRetryPending(false)
+        , m_PayloadUpdateDepth(0)
+        , m_IntervalScheduler({ MBED_CONF_APP_ADAPTIVE_INTERVAL_MIN_MS,
+                                MBED_CONF_APP_ADAPTIVE_INTERVAL_MAX_MS,
+                                MBED_CONF_APP_ADAPTIVE_INTERVAL_BACKOFF_FACTOR,
+                                MBED_CONF_APP_ADAPTIVE_INTERVAL_STABLE_UPDATES })
+        , m_AdaptiveInterval(MBED_CONF_APP_ADAPTIVE_INTERVAL)
+        , m_AdvertisingIntervalMs(m_AdaptiveInterval ? m_IntervalScheduler.interval_ms()
+                                                     : MBED_CONF_APP_ADVERTISING_INTERVAL_MS)
+        , m_IntervalChangePending(false)
+        , m_PayloadChanged(false)
+    {
+        add_advertised_field(m_BatteryLevel, GattService::UUID_BATTERY_SERVICE);
+
+#if MBED_CONF_APP_COMPACT_TELEMETRY
+        /* 0 to 100%, drifting by a percent per sample */
+        add_compact_telemetry_channel(mbed::callback(this, &BluetoothLowEnergyEncapsulation::battery_level_telemetry),
+                                      { 8, 5 });
+#endif
+
+#if MBED_CONF_APP_UNIT_NAME
+        /* the digits read '0' until derive_unit_name() or the first
+         * private ID fills them in */
+        memcpy(m_UnitName, UNIT_NAME_PREFIX, NameStructure_t::digits_offset());
+        memset(&m_UnitName[NameStructure_t::digits_offset()], '0', UNIT_ID_DIGITS);
+#endif
+    }
+
+    /** Advertise field as 16-bit UUID service data. Fields must be added
+     *  before start(), sampled every app.sample-interval-ms and written into
+     *  the payloads every app.update-interval-ms. */
+    bool add_advertised_field(AdvertisedFieldBase &field, uint16_t serviceUuid)
+    {
+        return m_AdvertisedFields.add(field, serviceUuid);
+    }
+
+    /** Replace the manufacturer specific data of the legacy scan response.
+     *  The scan response has a buffer and builder of its own, so that this
+     *  is the only time it is rebuilt, and it is only written to the
+     *  controller when it actually differs. Extended sets are not scannable
+     *  and carry no scan response. */
+    ble_error_t set_scan_response_manufacturer_data(mbed::Span<const uint8_t> data)
+    {
+        if (m_ExtendedAdvertising)
+        {
+            return BLE_ERROR_OPERATION_NOT_PERMITTED;
+        }
+
+        m_ScanResponseDataBuilder.clear();
+
+        ble_error_t error = m_ScanResponseDataBuilder.setManufacturerSpecificData(data);
+
+        if (error)
+        {
+            return error;
+        }
+
+        m_ScanResponse = m_ScanResponseDataBuilder.getAdvertisingData();
+
+        return commit_scan_response();
+    }
+
+#if MBED_CONF_APP_COMPACT_TELEMETRY
+    /** Add a channel to the compact telemetry in the scan response, read
+     *  from source every app.compact-telemetry-sample-interval-ms. Channels
+     *  must be added before start(), the battery level being the first. */
+    bool add_compact_telemetry_channel(mbed::Callback<int32_t()> source, const CompactTelemetryChannel_t &channel)
+    {
+        if (!m_CompactTelemetry.add_channel(channel))
+        {
+            return false;
+        }
+
+        m_CompactTelemetrySources[m_CompactTelemetry.channels() - 1] = source;
+        return true;
+    }
+#endif
+
+    /** Let the advertising interval follow the payload change rate, within
+     *  the bounds and backoff set by policy. */
+    void set_adaptive_interval_policy(const AdaptiveIntervalScheduler::Policy_t &policy)
+    {
+        m_IntervalScheduler.set_policy(policy);
+        m_AdaptiveInterval = true;
+    }
+
+    /** Payload changes arriving closer together than interval are coalesced
+     *  into a single controller write issued once the interval has elapsed. */
+    void set_minimum_commit_interval(rtos::Kernel::Clock::duration interval)
+    {
+        m_MinimumCommitInterval = interval;
+    }
+
+    /** Open a payload transaction. Fields changed until the matching
+     *  commit_payload_update() are only staged in m_AdvertisingBuffer,
+     *  no matter how many of them there are. Transactions may nest. */
+    void begin_payload_update()
+    {
+        ++m_PayloadUpdateDepth;
+    }
+
+    /** Close a payload transaction. Closing the outermost one flushes all
+     *  staged fields to the controller in a single write. */
+    ble_error_t commit_payload_update()
+    {
+        MBED_ASSERT(m_PayloadUpdateDepth > 0);
+
+        if (--m_PayloadUpdateDepth > 0)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t error = commit_advertising_payload();
+
+#if PERIODIC_ADVERTISING_ENABLED
+        ble_error_t periodicError = commit_periodic_advertising_payload();
+
+        if (!error)
+        {
+            error = periodicError;
+        }
+#endif
+
+        return error;
+    }
+
+    /** Run another extended advertising set next to the main one, with its
+     *  own interval and a fixed payload. The payload memory must stay valid
+     *  while the set is advertising. Only available in extended mode. */
+    ble_error_t start_additional_advertising_set(ble::adv_interval_t interval,
+                                                 mbed::Span<const uint8_t> payload,
+                                                 ble::advertising_handle_t &handle)
+    {
+#if EXTENDED_ADVERTISING_ENABLED
+        if (!m_ExtendedAdvertising)
+        {
+            return BLE_ERROR_OPERATION_NOT_PERMITTED;
+        }
+
+        ble::Gap &gap = m_BluetoothLowEnergyStack.gap();
+
+        ble::AdvertisingParameters parameters(
+            ble::advertising_type_t::NON_CONNECTABLE_UNDIRECTED,
+            interval
+        );
+        parameters.setUseLegacyPDU(false);
+
+        ble_error_t error = gap.createAdvertisingSet(&handle, parameters);
+
+        if (error)
+        {
+            return error;
+        }
+
+        error = PROFILED_CALL(SET_ADVERTISING_PAYLOAD, gap.setAdvertisingPayload(handle, payload));
+
+        if (!error)
+        {
+            error = PROFILED_CALL(START_ADVERTISING, gap.startAdvertising(handle));
+        }
+
+        if (error)
+        {
+            gap.destroyAdvertisingSet(handle);
+        }
+
+        return error;
+#else
+        return BLE_ERROR_NOT_IMPLEMENTED;
+#endif
+    }
+
+    /** hook runs once, right after advertising has first started. */
+    void on_first_advertisement(mbed::Callback<void()> hook)
+    {
+        m_FirstAdvertisementHook = hook;
+    }
+
+#if MBED_CONF_APP_OBSERVER
+    /** hook gets every advertising report the observer has not seen
+     *  before, in place of it being printed. It runs on the BLE event
+     *  queue, and the event only lives for the duration of the call. */
+    void on_observed_report(mbed::Callback<void(const ble::AdvertisingReportEvent &)> hook)
+    {
+        m_ObservedReportHook = hook;
+    }
+#endif
+
+    /** Kick off the stack initialization. All callbacks that follow run
+     *  from the event queue the object was constructed with, which the
+     *  caller is responsible for dispatching. */
+    void start()
+    {
+#if MBED_CONF_APP_DMA_SAMPLING
+        /* the first block is in well before advertising starts */
+        BatteryAdc_t::start(m_BatterySampler);
+#endif
+
+        /* mbed will call on_init_complete when when ble is ready */
+        m_BluetoothLowEnergyStack.init(this, &BluetoothLowEnergyEncapsulation::on_init_complete);
+    }
+
+    /** To be called every time BLE::processEvents() returns, on the same
+     *  queue. A payload write the stack could not take at the time, i.e.
+     *  that failed with BLE_STACK_BUSY or BLE_ERROR_NO_MEM, is retried here,
+     *  once the stack has made progress. Only the latest payload is ever
+     *  pending, since it is what m_AdvertisingBuffer holds, so any number
+     *  of rejected updates leaves at most one write to retry. */
+    void on_ble_events_processed()
+    {
+        if (!m_CommitRetryPending)
+        {
+            return;
+        }
+
+        m_CommitRetryPending = false;
+
+        ble_error_t error = commit_advertising_payload();
+
+        if (error)
+        {
+            LOG_PRINTF("Error! retried _ble.gap().setAdvertisingPayload() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+
+#if PERIODIC_ADVERTISING_ENABLED
+        error = commit_periodic_advertising_payload();
+
+        if (error)
+        {
+            LOG_PRINTF("Error! retried _ble.gap().setPeriodicAdvertisingPayload() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+#endif
+    }
+
+private:
+    /** Callback triggered when the ble initialization process has finished */
+    void on_init_complete(BLE::InitializationCompleteCallbackContext *params)
+    {
+        if (params->error != BLE_ERROR_NONE)
+        {
+            LOG_PRINTF("Error! BLE initialization failed: \
+                [%d] -> %s\r\n", params->error, ToString(params->error));
+            //print_error(params->error, "Ble initialization failed.");
+            return;
+        }
+
+#if MBED_CONF_APP_BOOT_TIME_REPORT
+        BootTimeRecord::mark(BootTimeRecord::BLE_INITIALIZED);
+#endif
+
+#if !MBED_CONF_APP_FAST_BOOT
+        print_mac_address();
+#endif
+
+#if PRIVATE_UNIT_ID_ENABLED
+        /* the address tells nothing about the unit, nor must its name */
+        if (m_PrivateUnitId.prepare())
+        {
+            memcpy(&m_UnitName[NameStructure_t::digits_offset()], m_PrivateUnitId.next_digits(), UNIT_ID_DIGITS);
+        }
+#elif MBED_CONF_APP_UNIT_NAME
+        derive_unit_name();
+#endif
+
+        /* receive advertising start/end and other GAP events */
+        m_BluetoothLowEnergyStack.gap().setEventHandler(this);
+
+#if MBED_CONF_APP_PRIVACY
+        enable_privacy();
+#endif
+
+#if MBED_CONF_APP_CONNECTABLE
+        /* the services must be in place before anyone can connect */
+        ble_error_t error = m_TelemetryServer.start(m_BluetoothLowEnergyStack, m_AdvertisedFields.encoded_size());
+
+        if (error)
+        {
+            LOG_PRINTF("Error! Adding the GATT services failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+
+        /* every notification sent marks a connection event */
+        m_TelemetryServer.on_data_sent(mbed::callback(this, &BluetoothLowEnergyEncapsulation::on_connection_event));
+
+        /* have the central's requests for other connection parameters
+         * passed up, rather than accepted as they are */
+        error = m_BluetoothLowEnergyStack.gap().manageConnectionParametersUpdateRequest(true);
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gap().manageConnectionParametersUpdateRequest() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+#endif
+
+        start_advertising();
+
+#if MBED_CONF_APP_OBSERVER
+        start_observing();
+#endif
+    }
+
+    void start_advertising()
+    {
+        // Advertising and Scan Response Data
+        //
+        // There are two ways to send advertising out with GAP. 
+        // The Advertising Data payload and the Scan Response payload.
+        //
+        // Both payloads are identical and can contain up to 31 bytes of
+        // data, but only the advertising data payload is mandatory, since
+        // this is the payload that will be constantly transmitted out 
+        // from the device to let central devices in range know that it 
+        // exists. The scan response payload is an optional secondary 
+        // payload that central devices can request, and allows device 
+        // designers to fit a bit more information in the advertising
+        // payload such a strings for a device name, etc.
+        
+        // Extended Advertising
+        //
+        // Bluetooth 5 controllers can additionally run advertising sets
+        // that use the extended PDUs. A set's data is chained over the
+        // secondary advertising channels, which lifts the 31 byte limit, and
+        // several sets can run side by side with their own intervals. When
+        // enabled and supported by the controller, everything (including the
+        // vendor specific data) goes into a single large non-scannable
+        // payload. Otherwise the legacy layout below is used unchanged.
+        m_ExtendedAdvertising = is_extended_advertising_available();
+
+        if (m_ExtendedAdvertising)
+        {
+            m_AdvertisingDataBuilder = ble::AdvertisingDataBuilder(
+                                           m_AdvertisingBuffer,
+                                           extended_advertising_capacity()
+                                       );
+        }
+
+        /* create advertising parameters and payload */
+        ble::AdvertisingParameters advertisingParameters = make_advertising_parameters();
+
+        if (!m_ExtendedAdvertising)
+        {
+            /* when advertising you can optionally add extra data that is only sent
+             * if the central requests it by doing active scanning (sending scan requests),
+             * until set_scan_response_manufacturer_data() is called it goes out
+             * straight from its image in flash */
+            ble_error_t error = commit_scan_response();
+
+            if (error)
+            {
+                LOG_PRINTF("Error! _ble.gap().setAdvertisingScanResponse() failed: \
+                    [%d] -> %s\r\n", error, ToString(error));
+            }
+        }
+
+        /* now we set the advertising payload that gets sent during 
+         * advertising without any scan requests. Each field's value is
+         * bound to where it lives in m_AdvertisingBuffer so that updates
+         * can store straight into it instead of asking the builder to
+         * search for and rewrite the service data fields */
+        m_AdvertisedFields.unbind_all();
+
+        ble_error_t error = uses_legacy_layout() ? load_legacy_advertising_payload()
+                                                 : build_advertising_payload();
+
+        if (error)
+        {
+            LOG_PRINTF("Error! Building the advertising payload failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+            return;
+        }
+
+#if PRIVATE_UNIT_ID_ENABLED
+        /* where the rotations store the new digits, legacy or not */
+        error = m_UnitIdField.bind(m_AdvertisingPayload,
+                                   ble::adv_data_type_t::SHORTENED_LOCAL_NAME,
+                                   mbed::make_const_Span(reinterpret_cast<const uint8_t *>(UNIT_NAME_PREFIX),
+                                                         NameStructure_t::digits_offset()));
+
+        if (error)
+        {
+            LOG_PRINTF("Error! Locating the unit name failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+#endif
+
+#if MBED_CONF_APP_BEACON_ROTATION
+        /* the third party beacon formats are legacy payloads */
+        if (!m_ExtendedAdvertising)
+        {
+            setup_beacon_rotation();
+        }
+#endif
+
+        /* setup advertising */
+        error = configure_advertising_set(advertisingParameters);
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gap().setAdvertisingParameters() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+            //print_error(error, "_ble.gap().setAdvertisingParameters() failed");
+            return;
+        }
+
+        error = commit_advertising_payload();
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gap().setAdvertisingPayload() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+            //print_error(error, "_ble.gap().setAdvertisingPayload() failed");
+            return;
+        }
+
+        /* start advertising */
+        error = PROFILED_CALL(START_ADVERTISING,
+                    m_BluetoothLowEnergyStack.gap().startAdvertising(m_AdvertisingHandle));
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gap().startAdvertising() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+            //print_error(error, "_ble.gap().startAdvertising() failed");
+            return;
+        }
+
+#if MBED_CONF_APP_HEALTH_COUNTERS
+        m_HealthCounters.on_advertising_started(uptime_ms(), m_AdvertisingIntervalMs);
+#endif
+
+        if (!m_FirstAdvertisementStarted)
+        {
+            on_first_advertisement_started();
+        }
+
+        // Nuertey Odzeyem Note:
+        //
+        // Here, note that the EventQueue is not intrinsic nor necessary
+        // for the operation of the BLE Advertisement Service. Advertisements
+        // will always be ongoing, continuously. The EventQueue just helps
+        // us simulate a battery charging and discharging so that its value
+        // when changed can then be written into those continuous BLE
+        // advertisements. Separation of the application business logic
+        // and the BLE feature so to speak. To further clarify, the execution
+        // context needed to schedule BLE events/callbacks, could have
+        // been supplied by a thread.
+
+#if PERIODIC_ADVERTISING_ENABLED
+        if (m_ExtendedAdvertising
+            && m_BluetoothLowEnergyStack.gap().isFeatureSupported(
+                   ble::controller_supported_features_t::LE_PERIODIC_ADVERTISING))
+        {
+            error = start_periodic_advertising();
+
+            if (error)
+            {
+                /* the extended set itself keeps advertising regardless */
+                LOG_PRINTF("Error! start_periodic_advertising() failed: \
+                    [%d] -> %s\r\n", error, ToString(error));
+            }
+        }
+#endif
+
+#if MBED_CONF_APP_COMPACT_TELEMETRY
+        /* frames go in the scan response, which extended sets lack */
+        if (!m_ExtendedAdvertising)
+        {
+            m_SharedEventQueue.call_every("compact telemetry", std::chrono::milliseconds(MBED_CONF_APP_COMPACT_TELEMETRY_SAMPLE_INTERVAL_MS), [this]()
+                                                  {
+                                                      run_between_connection_events("compact telemetry", [this]()
+                                                                                                         {
+                                                                                                             sample_compact_telemetry();
+                                                                                                         }
+                                                      );
+                                                  }
+            );
+        }
+#endif
+
+#if MBED_CONF_APP_BEACON_ROTATION
+        if (!m_ExtendedAdvertising)
+        {
+            m_SharedEventQueue.call_every("beacon rotation", std::chrono::milliseconds(MBED_CONF_APP_BEACON_ROTATION_INTERVAL_MS), [this]()
+                                                  {
+                                                      rotate_beacon_frame();
+                                                  }
+            );
+        }
+#endif
+
+#if MBED_CONF_APP_HEALTH_COUNTERS
+        m_SharedEventQueue.call_every("health report", std::chrono::milliseconds(MBED_CONF_APP_HEALTH_REPORT_INTERVAL_MS), [this]()
+                                              {
+                                                  report_health();
+                                              }
+        );
+#endif
+
+#if MBED_CONF_APP_THROUGHPUT_BENCHMARK
+        /* the regular updates only start once the ramp is over */
+        start_throughput_benchmark_step();
+#else
+        schedule_updates();
+#endif
+    }
+
+    /** Sample and update the advertised fields from now on. */
+    void schedule_updates()
+    {
+#if MBED_CONF_APP_LOW_POWER
+        schedule_low_power_updates();
+#else
+        /* sensors are read on their own schedule, independently of when
+         * their latest values get written into the payloads */
+        m_SharedEventQueue.call_every("sample", std::chrono::milliseconds(MBED_CONF_APP_SAMPLE_INTERVAL_MS), [this]()
+                                              {
+                                                  m_AdvertisedFields.sample_all();
+                                              }
+        );
+
+        /* we simulate battery discharging by updating it every second,
+         * or at whatever app.update-interval-ms asks for */
+        m_SharedEventQueue.call_every("update", std::chrono::milliseconds(MBED_CONF_APP_UPDATE_INTERVAL_MS), [this]()
+                                              {
+                                                  run_between_connection_events("update", [this]()
+                                                                                          {
+                                                                                              update_battery_level();
+                                                                                          }
+                                                  );
+                                              }
+        );
+#endif
+    }
+
+    /** Run work now or, while connected, once the radio is between two
+     *  connection events, see ConnectionEventScheduler, posted under the
+     *  name site then. */
+    template <typename F>
+    void run_between_connection_events(const char *site, F work)
+    {
+#if MBED_CONF_APP_CONNECTABLE
+        const uint32_t delayMs = m_ConnectionEventScheduler.delay_us(us_ticker_read()) / 1000;
+
+        /* the queue counts whole milliseconds, and less than one is
+         * already as good as it gets */
+        if (m_Connected && (delayMs > 0))
+        {
+            if (m_SharedEventQueue.call_in(site, std::chrono::milliseconds(delayMs), work))
+            {
+                return;
+            }
+
+            /* no room in the queue, better badly timed than not at all */
+        }
+#endif
+
+        work();
+    }
+
+#if MBED_CONF_APP_THROUGHPUT_BENCHMARK
+    // Throughput Benchmark
+    //
+    // Drives setAdvertisingPayload() at ever shorter intervals to find how
+    // fast the stack and controller take payload updates, see
+    // ThroughputBenchmark. Every update changes the battery level, and
+    // goes straight to the stack, past the committed payload shadow and the
+    // minimum commit interval, both of which would hide the ceiling.
+
+    void start_throughput_benchmark_step()
+    {
+        m_ThroughputBenchmarkStepStart = rtos::Kernel::Clock::now();
+
+        m_ThroughputBenchmarkTicker = m_SharedEventQueue.call_every(
+            "benchmark update", std::chrono::milliseconds(m_ThroughputBenchmark.interval_ms()), [this]()
+            {
+                benchmark_payload_update();
+            }
+        );
+
+        const int id = m_SharedEventQueue.call_in("benchmark step end", std::chrono::milliseconds(MBED_CONF_APP_THROUGHPUT_BENCHMARK_STEP_MS), [this]()
+                                                  {
+                                                      end_throughput_benchmark_step();
+                                                  }
+        );
+
+        if (!m_ThroughputBenchmarkTicker || !id)
+        {
+            LOG_PRINTF("Error! Scheduling the throughput benchmark failed: \
+                [%d] -> %s\r\n", BLE_ERROR_NO_MEM, ToString(BLE_ERROR_NO_MEM));
+        }
+    }
+
+    void end_throughput_benchmark_step()
+    {
+        m_SharedEventQueue.cancel(m_ThroughputBenchmarkTicker);
+
+        const auto elapsed = rtos::Kernel::Clock::now() - m_ThroughputBenchmarkStepStart;
+
+        if (m_ThroughputBenchmark.end_step(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count())))
+        {
+            start_throughput_benchmark_step();
+            return;
+        }
+
+        m_ThroughputBenchmark.print_report();
+        schedule_updates();
+    }
+
+    void benchmark_payload_update()
+    {
+        m_AdvertisedFields.sample_all();
+        m_AdvertisedFields.encode_all();
+
+        const auto payload = advertising_payload();
+
+        const uint32_t start = us_ticker_read();
+        ble_error_t error = m_BluetoothLowEnergyStack.gap().setAdvertisingPayload(m_AdvertisingHandle, payload);
+        m_ThroughputBenchmark.record(error, us_ticker_read() - start);
+
+        if (!error)
+        {
+            m_CommittedPayload.record(payload);
+            m_LastCommitTime = rtos::Kernel::Clock::now();
+        }
+    }
+#endif
+
+    /** Whatever was held back to get advertising up sooner runs here. */
+    void on_first_advertisement_started()
+    {
+        m_FirstAdvertisementStarted = true;
+
+#if MBED_CONF_APP_BOOT_TIME_REPORT
+        BootTimeRecord::mark(BootTimeRecord::ADVERTISING_STARTED);
+#endif
+
+#if MBED_CONF_APP_FAST_BOOT
+        print_mac_address();
+#endif
+
+        if (m_FirstAdvertisementHook)
+        {
+            m_FirstAdvertisementHook();
+        }
+    }
+
+#if MBED_CONF_APP_LOW_POWER
+    /** Every timer event wakes the MCU, so sampling and the payload update
+     *  share one, and it fires no more often than the payload can be seen,
+     *  i.e. once per whole number of advertising intervals. The period
+     *  follows the advertising interval: request_advertising_interval()
+     *  posts a call back in whenever that changes. */
+    void schedule_low_power_updates()
+    {
+        const uint32_t periodMs = low_power_update_interval_ms();
+
+        if (m_LowPowerUpdateTicker)
+        {
+            if (periodMs == m_LowPowerUpdatePeriodMs)
+            {
+                return;
+            }
+
+            m_SharedEventQueue.cancel(m_LowPowerUpdateTicker);
+        }
+
+        m_LowPowerUpdatePeriodMs = periodMs;
+        m_LowPowerUpdateTicker   = m_SharedEventQueue.call_every("low power update", std::chrono::milliseconds(periodMs), [this]()
+                                                                 {
+                                                                     run_between_connection_events("low power update", [this]()
+                                                                                                                       {
+                                                                                                                           m_AdvertisedFields.sample_all();
+                                                                                                                           update_battery_level();
+                                                                                                                       }
+                                                                     );
+                                                                 }
+        );
+
+        if (!m_LowPowerUpdateTicker)
+        {
+            LOG_PRINTF("Error! Scheduling the payload updates failed: \
+                [%d] -> %s\r\n", BLE_ERROR_NO_MEM, ToString(BLE_ERROR_NO_MEM));
+        }
+    }
+
+    /** app.update-interval-ms rounded up to a multiple of the advertising
+     *  interval. A payload written part way through an interval is not seen
+     *  before the next advertising event anyway, so updating on the interval
+     *  grid never delays what scanners see and wastes no wake-ups. The
+     *  Gap API offers no hook into the advertising events themselves, hence
+     *  the period is aligned rather than the phase. */
+    uint32_t low_power_update_interval_ms() const
+    {
+        const uint32_t intervals = (MBED_CONF_APP_UPDATE_INTERVAL_MS + m_AdvertisingIntervalMs - 1)
+                                   / m_AdvertisingIntervalMs;
+
+        return ((intervals > 0) ? intervals : 1) * m_AdvertisingIntervalMs;
+    }
+#endif
+
+    /** Source of the battery level field: a battery that drains by 1% per
+     *  sample, from 50% down to 10% and then jumps back to 100%. */
+    uint8_t simulate_battery_level()
+    {
+        if (m_TheBatteryLevel-- == 10)
+        {
+            m_TheBatteryLevel = 100;
+        }
+
+        return m_TheBatteryLevel;
+    }
+
+#if MBED_CONF_APP_DMA_SAMPLING
+    /** Source of the battery level field with app.dma-sampling: the latest
+     *  voltage the sampler handed over, 2.0 V to 3.0 V mapping to 0 to 100%
+     *  as in the Eddystone-TLM frame. Only reads the slot, so it never
+     *  waits on the ADC; the level stays put until the first block is in. */
+    uint8_t sampled_battery_level()
+    {
+        uint16_t sample;
+
+        if (m_BatterySampler.latest(sample))
+        {
+            const uint32_t millivolts = BatteryAdc_t::to_millivolts(sample);
+
+            m_TheBatteryLevel = (millivolts <= 2000) ? 0
+                              : (millivolts >= 3000) ? 100
+                              : static_cast<uint8_t>((millivolts - 2000) / 10);
+        }
+
+        return m_TheBatteryLevel;
+    }
+#endif
+
+    /** Whether the payload is the precomputed legacy one, i.e. legacy
+     *  advertising and no fields registered beyond the battery level. */
+    bool uses_legacy_layout() const
+    {
+        return !m_ExtendedAdvertising
+               && (m_AdvertisedFields.size() == LEGACY_LAYOUT_ADVERTISED_FIELDS);
+    }
+
+#if MBED_CONF_APP_UNIT_NAME && !PRIVATE_UNIT_ID_ENABLED
+    /** Put this unit's name together from the address print_mac_address()
+     *  shows, into m_UnitName. */
+    void derive_unit_name()
+    {
+        static constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+
+        ble::own_address_type_t addressType;
+        ble::address_t          address;
+
+        ble_error_t error = m_BluetoothLowEnergyStack.gap().getAddress(addressType, address);
+
+        if (error)
+        {
+            /* the digits stay '0', the fleet name at least is right */
+            LOG_PRINTF("Error! _ble.gap().getAddress() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+            return;
+        }
+
+        /* addresses are stored least significant byte first */
+        char *digits = &m_UnitName[NameStructure_t::digits_offset()];
+
+        for (size_t i = 0; i < UNIT_ID_DIGITS / 2; ++i)
+        {
+            const uint8_t byte = address.data()[UNIT_ID_DIGITS / 2 - 1 - i];
+
+            digits[2 * i]     = HEX_DIGITS[byte >> 4];
+            digits[2 * i + 1] = HEX_DIGITS[byte & 0x0F];
+        }
+    }
+#endif
+
+    /** Copy the legacy payload image into m_AdvertisingBuffer, the battery
+     *  level being at a known offset there is no builder pass or search. */
+    ble_error_t load_legacy_advertising_payload()
+    {
+        memcpy(m_AdvertisingBuffer, gs_LegacyAdvertisingImage.m_Bytes, sizeof(gs_LegacyAdvertisingImage.m_Bytes));
+        m_AdvertisingPayload = mbed::make_const_Span(m_AdvertisingBuffer, sizeof(gs_LegacyAdvertisingImage.m_Bytes));
+
+#if MBED_CONF_APP_UNIT_NAME
+        memcpy(&m_AdvertisingBuffer[LEGACY_UNIT_ID_OFFSET],
+               &m_UnitName[NameStructure_t::digits_offset()],
+               UNIT_ID_DIGITS);
+#endif
+
+        if (!m_BatteryLevel.bind(mbed::make_Span(&m_AdvertisingBuffer[LEGACY_BATTERY_LEVEL_OFFSET], sizeof(uint8_t))))
+        {
+            return BLE_ERROR_NO_MEM;
+        }
+
+        m_AdvertisedFields.encode_all();
+
+        return BLE_ERROR_NONE;
+    }
+
+    /** Assemble the payload at run time, for layouts only known then: an
+     *  extended advertising set or additional advertised fields. */
+    ble_error_t build_advertising_payload()
+    {
+        m_AdvertisingDataBuilder.clear();
+        m_AdvertisingDataBuilder.setFlags();
+#if MBED_CONF_APP_UNIT_NAME
+        m_AdvertisingDataBuilder.setName(m_UnitName, false);
+#else
+        m_AdvertisingDataBuilder.setName(DEVICE_NAME);
+#endif
+
+        /* we add the battery level (and any other advertised field) as part
+         * of the payload so it's visible to any device that scans, this part
+         * of the payload will be updated periodically without affecting the
+         * rest of the payload */
+        ble_error_t error = add_advertised_fields(m_AdvertisingDataBuilder);
+
+        if (!error && m_ExtendedAdvertising)
+        {
+            /* no scan response to split the data across, it all fits here */
+            error = m_AdvertisingDataBuilder.setManufacturerSpecificData(
+                        mbed::make_const_Span(&gs_LegacyScanResponseImage.m_Bytes[LegacyScanResponseLayout_t::data_offset(0)],
+                                              VendorSpecificData_t::data_size())
+                    );
+        }
+
+        if (!error)
+        {
+            m_AdvertisingPayload = m_AdvertisingDataBuilder.getAdvertisingData();
+            error = bind_advertised_fields(m_AdvertisingDataBuilder.getAdvertisingData(), m_AdvertisingBuffer);
+        }
+
+        return error;
+    }
+
+#if MBED_CONF_APP_BEACON_ROTATION
+    /** Record where every beacon frame lives and select the first one. The
+     *  frames are encoded ahead of time, so that rotating between them does
+     *  no more than swap the payload span and commit it. */
+    void setup_beacon_rotation()
+    {
+        m_BeaconFrames[BEACON_FORMAT_CUSTOM]        = m_AdvertisingPayload;
+        m_BeaconFrames[BEACON_FORMAT_IBEACON]       = mbed::make_const_Span(gs_IBeaconImage.m_Bytes);
+        m_BeaconFrames[BEACON_FORMAT_EDDYSTONE_UID] = mbed::make_const_Span(gs_EddystoneUidImage.m_Bytes);
+        m_BeaconFrames[BEACON_FORMAT_EDDYSTONE_TLM] = mbed::make_const_Span(m_EddystoneTlmFrame);
+
+        memcpy(m_EddystoneTlmFrame, gs_EddystoneTlmImage.m_Bytes, sizeof(m_EddystoneTlmFrame));
+
+#if DIAGNOSTICS_FRAME_ENABLED
+        m_BeaconFrames[BEACON_FORMAT_DIAGNOSTICS]   = mbed::make_const_Span(m_DiagnosticsFrame);
+
+        memcpy(m_DiagnosticsFrame, gs_DiagnosticsImage.m_Bytes, sizeof(m_DiagnosticsFrame));
+#endif
+
+        m_BeaconFormat = BEACON_FORMAT_COUNT - 1;
+        select_next_beacon_frame();
+    }
+
+    /** Point the payload at the next format in app.beacon-rotation-formats,
+     *  less those app.privacy leaves out. */
+    void select_next_beacon_frame()
+    {
+        do
+        {
+            m_BeaconFormat = (m_BeaconFormat + 1) % BEACON_FORMAT_COUNT;
+        }
+        while (!(BEACON_ROTATION_FORMATS & (1u << m_BeaconFormat)));
+
+        if (m_BeaconFormat == BEACON_FORMAT_EDDYSTONE_TLM)
+        {
+            update_eddystone_tlm_frame();
+        }
+
+#if DIAGNOSTICS_FRAME_ENABLED
+        if (m_BeaconFormat == BEACON_FORMAT_DIAGNOSTICS)
+        {
+            update_diagnostics_frame();
+        }
+#endif
+
+        m_AdvertisingPayload = m_BeaconFrames[m_BeaconFormat];
+    }
+
+    void rotate_beacon_frame()
+    {
+        select_next_beacon_frame();
+
+        ble_error_t error = commit_advertising_payload();
+
+        if (error)
+        {
+            LOG_PRINTF("Error! Rotating to beacon format %u failed: \
+                [%d] -> %s\r\n", m_BeaconFormat, error, ToString(error));
+        }
+    }
+
+    void update_eddystone_tlm_frame()
+    {
+        const uint32_t uptimeMs = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                rtos::Kernel::Clock::now().time_since_epoch()).count());
+
+        // The simulated battery spans 2.0 V when empty to 3.0 V when full,
+        // and the PDU count is estimated from the current interval since
+        // the controller does not report it, or with app.health-counters
+        // from the time spent at each interval.
+#if MBED_CONF_APP_HEALTH_COUNTERS
+        const uint32_t advertisingCount = m_HealthCounters.advertising_events(uptimeMs);
+#else
+        const uint32_t advertisingCount = uptimeMs / m_AdvertisingIntervalMs;
+#endif
+
+        encode_eddystone_tlm(m_EddystoneTlmFrame,
+                             static_cast<uint16_t>(2000 + 10 * m_BatteryLevel.latest()),
+                             advertisingCount,
+                             uptimeMs / 100);
+    }
+#endif
+
+#if DIAGNOSTICS_FRAME_ENABLED
+    void update_diagnostics_frame()
+    {
+        encode_diagnostics(m_DiagnosticsFrame, diagnostics_reading());
+    }
+#endif
+
+#if MBED_CONF_APP_HEALTH_COUNTERS
+    // Health Counters
+    //
+    // What the radio and the stack have done since start up, printed every
+    // app.health-report-interval-ms and, with the diagnostics beacon
+    // format, advertised. See HealthCounters.
+
+    static uint64_t uptime_ms()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                   rtos::Kernel::Clock::now().time_since_epoch()).count());
+    }
+
+    DiagnosticsReading_t diagnostics_reading() const
+    {
+        DiagnosticsReading_t reading = {};
+
+        reading.m_PayloadCommits    = m_HealthCounters.payload_commits();
+        reading.m_StackBusy         = m_HealthCounters.commit_failures(BLE_STACK_BUSY);
+        reading.m_NoMemory          = m_HealthCounters.commit_failures(BLE_ERROR_NO_MEM);
+        reading.m_OtherFailures     = m_HealthCounters.commit_failures() - reading.m_StackBusy - reading.m_NoMemory;
+        reading.m_AdvertisingEvents = m_HealthCounters.advertising_events(uptime_ms());
+        reading.m_ScanRequests      = m_HealthCounters.scan_requests();
+        reading.m_CpuIdlePercent    = m_HealthCounters.cpu_idle_percent();
+
+#if MBED_CONF_APP_EVENT_QUEUE_INSTRUMENTATION
+        const InstrumentedEventQueue::Statistics_t queue = m_SharedEventQueue.statistics();
+
+        reading.m_EventsPending     = static_cast<uint8_t>((queue.m_Pending < 0xFF) ? queue.m_Pending : 0xFE);
+        reading.m_EventsPendingPeak = static_cast<uint8_t>((queue.m_PendingHighWaterMark < 0xFF)
+                                                           ? queue.m_PendingHighWaterMark : 0xFE);
+#else
+        /* only an instrumented queue keeps count */
+        reading.m_EventsPending     = 0xFF;
+        reading.m_EventsPendingPeak = 0xFF;
+#endif
+
+        return reading;
+    }
+
+    /** Close the CPU window and print the counters, with a line for each
+     *  error that refused payload writes. */
+    void report_health()
+    {
+        mbed_stats_cpu_t cpu;
+        mbed_stats_cpu_get(&cpu);
+        m_HealthCounters.on_cpu_sample(cpu.uptime, cpu.idle_time);
+
+        const DiagnosticsReading_t reading = diagnostics_reading();
+
+        LOG_PRINTF("Health: payload writes %lu, refused %lu, advertising events %lu, scan requests %lu\r\n",
+                   static_cast<unsigned long>(reading.m_PayloadCommits),
+                   static_cast<unsigned long>(m_HealthCounters.commit_failures()),
+                   static_cast<unsigned long>(reading.m_AdvertisingEvents),
+                   static_cast<unsigned long>(reading.m_ScanRequests));
+        LOG_PRINTF("Health: events pending %u (peak %u), CPU idle %u%%\r\n",
+                   static_cast<unsigned>(reading.m_EventsPending),
+                   static_cast<unsigned>(reading.m_EventsPendingPeak),
+                   static_cast<unsigned>(reading.m_CpuIdlePercent));
+
+        for (size_t code = 0; code <= ERROR_CODES_TABLE_SIZE; ++code)
+        {
+            const uint32_t failures = m_HealthCounters.commit_failures(code);
+
+            if (failures)
+            {
+                LOG_PRINTF("Health: %lu payload writes refused with \
+                    [%d] -> %s\r\n", static_cast<unsigned long>(failures),
+                           static_cast<int>(code), ToString(static_cast<ble_error_t>(code)));
+            }
+        }
+    }
+
+    void onScanRequestReceived(const ble::ScanRequestEvent &event) override
+    {
+        if (event.getAdvHandle() == m_AdvertisingHandle)
+        {
+            m_HealthCounters.on_scan_request();
+        }
+    }
+#endif
+
+#if MBED_CONF_APP_COMPACT_TELEMETRY
+    /** Take a sample of every compact telemetry channel and put the frame
+     *  of the newest samples in the scan response. */
+    void sample_compact_telemetry()
+    {
+        int32_t values[MBED_CONF_APP_COMPACT_TELEMETRY_MAX_CHANNELS];
+
+        for (size_t i = 0; i < m_CompactTelemetry.channels(); ++i)
+        {
+            values[i] = m_CompactTelemetrySources[i]();
+        }
+
+        m_CompactTelemetry.push(mbed::make_const_Span(values, m_CompactTelemetry.channels()));
+
+        uint8_t data[COMPACT_TELEMETRY_COMPANY_ID_SIZE + COMPACT_TELEMETRY_FRAME_SIZE] = {
+            gs_LegacyScanResponseImage.m_Bytes[LegacyScanResponseLayout_t::data_offset(0)],
+            gs_LegacyScanResponseImage.m_Bytes[LegacyScanResponseLayout_t::data_offset(0) + 1]
+        };
+
+        const size_t size = m_CompactTelemetry.encode(mbed::make_Span(&data[COMPACT_TELEMETRY_COMPANY_ID_SIZE],
+                                                                      COMPACT_TELEMETRY_FRAME_SIZE));
+
+        ble_error_t error = set_scan_response_manufacturer_data(
+                                mbed::make_const_Span(data, COMPACT_TELEMETRY_COMPANY_ID_SIZE + size));
+
+        if (error)
+        {
+            LOG_PRINTF("Error! Writing the compact telemetry frame failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+    }
+
+    int32_t battery_level_telemetry()
+    {
+        return m_BatteryLevel.latest();
+    }
+#endif
+
+    mbed::Span<const uint8_t> advertising_payload() const
+    {
+        return m_AdvertisingPayload;
+    }
+
+    /** Append a service data structure for every advertised field to builder. */
+    ble_error_t add_advertised_fields(ble::AdvertisingDataBuilder &builder)
+    {
+        static const uint8_t placeholder[AdvertisedFieldBase::MAX_ENCODED_SIZE] = {};
+
+        for (size_t i = 0; i < m_AdvertisedFields.size(); ++i)
+        {
+            ble_error_t error = PROFILED_CALL(SET_SERVICE_DATA,
+                                    builder.setServiceData(
+                                        m_AdvertisedFields.service_uuid(i),
+                                        mbed::make_const_Span(placeholder, m_AdvertisedFields.field(i).encoded_size())
+                                    )
+                                );
+
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        return BLE_ERROR_NONE;
+    }
+
+    /** Point every advertised field at its slot in buffer, which holds
+     *  payload, and encode the latest samples into them. */
+    ble_error_t bind_advertised_fields(mbed::Span<const uint8_t> payload,
+                                       mbed::Span<uint8_t> buffer)
+    {
+        for (size_t i = 0; i < m_AdvertisedFields.size(); ++i)
+        {
+            PatchableAdvertisingField location;
+
+            ble_error_t error = location.bind_service_data(payload, m_AdvertisedFields.service_uuid(i));
+
+            if (error)
+            {
+                return error;
+            }
+
+            if (!m_AdvertisedFields.field(i).bind(location.slot(buffer)))
+            {
+                return BLE_ERROR_NO_MEM;
+            }
+        }
+
+        m_AdvertisedFields.encode_all();
+
+        return BLE_ERROR_NONE;
+    }
+
+    void update_battery_level()
+    {
+        // GATT
+        //
+        // GATT is an acronym for the Generic ATTribute Profile, and it defines
+        // the way that two Bluetooth Low Energy devices transfer data back and
+        // forth using concepts called Services and Characteristics. It makes use
+        // of a generic data protocol called the Attribute Protocol (ATT), which
+        // is used to store Services, Characteristics and related data in a
+        // simple lookup table using 16-bit IDs for each entry in the table.
+        // GATT comes into play once a dedicated connection is established between
+        // two devices, meaning that you have already gone through the advertising
+        // process governed by GAP.    
+        
+        // GATT Transactions
+        //
+        // An important concept to understand with GATT is the server/client relationship.
+        // The peripheral is known as the GATT Server, which holds the ATT lookup data and
+        // service and characteristic definitions, and the GATT Client (the phone/tablet), 
+        // which sends requests to this server.
+        // All transactions are started by the main device, the GATT Client, which receives
+        // response from the secondary device, the GATT Server.
+
+        // Broadcast Network Topology
+        //
+        // While most peripherals advertise themselves so that a connection can be established
+        // and GATT services and characteristics can be used (which allows for much more data
+        // to be exchanged and in both directions), there are situations where you only want to
+        // advertise data.
+        //
+        // The main use case here is where you want a peripheral to send data to more than
+        // one device at a time. This is only possible using the advertising packet since data
+        // sent and received in connected mode can only be seen by those two connected
+        // devices.
+        //
+        // By including a small amount of custom data in the 31 byte advertising or scan
+        // response payloads, you can use a low cost Bluetooth Low Energy peripheral to sent
+        // data one-way to any devices in listening range, as shown in the illustration below.
+        // This is known as Broadcasting in Bluetooth Low Energy.
+        //
+        // This is the approach use by Apple's iBeacon, for example, which inserts a custom
+        // payload in the main advertising packet, using the Manufacturer Specific Data field.
+        // 
+        // Once you establish a connection between your peripheral and a central device, the
+        // advertising process will generally stop and you will typically no longer be able to send
+        // advertising packets out anymore, and you will use GATT services and characteristics
+        // to communicate in both directions.
+        //
+        // With app.connectable, this device keeps advertising while connected, see the
+        // Connections section below.
+
+        /* update the payload with the latest value of the bettery level, 
+         * the rest of the payload remains the same so a store into each
+         * bound slot is all that is needed. Every other advertised field
+         * is staged alongside it and goes out in the same write */
+        begin_payload_update();
+        m_AdvertisedFields.encode_all();
+
+        /* set the new payload, we don't need to stop advertising */
+        ble_error_t error = commit_payload_update();
+
+#if MBED_CONF_APP_CONNECTABLE
+        /* a connected client reads or is notified of the same level */
+        ble_error_t gattError = m_TelemetryServer.set_battery_level(m_BatteryLevel.latest());
+
+        if (gattError)
+        {
+            LOG_PRINTF("Error! Writing the Battery Level characteristic failed: \
+                [%d] -> %s\r\n", gattError, ToString(gattError));
+        }
+#endif
+
+        /* let the advertising interval follow how often the payload changes */
+        update_advertising_interval();
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gap().setAdvertisingPayload() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+            //print_error(error, "_ble.gap().setAdvertisingPayload() failed");
+            return;
+        }
+    }
+
+    ble::AdvertisingParameters make_advertising_parameters() const
+    {
+        /* you cannot connect to this device, you can only read its advertising data,
+         * scannable means that the device has extra advertising data that the peer can receive if it
+         * "scans" it which means it is using active scanning (it sends a scan request).
+         * Extended scannable sets cannot carry advertising data, hence non-scannable */
+        ble::advertising_type_t advertisingType = m_ExtendedAdvertising
+                                                      ? ble::advertising_type_t::NON_CONNECTABLE_UNDIRECTED
+                                                      : ble::advertising_type_t::SCANNABLE_UNDIRECTED;
+
+#if MBED_CONF_APP_CONNECTABLE
+        /* a central may connect and read the GATT services, legacy
+         * connectable advertising is scannable as well while extended
+         * connectable sets are not, which they need not be. One central
+         * at a time, so while connected the set goes on as above */
+        if (!m_Connected)
+        {
+            advertisingType = ble::advertising_type_t::CONNECTABLE_UNDIRECTED;
+        }
+#endif
+
+        ble::AdvertisingParameters parameters(
+            advertisingType,
+            ble::adv_interval_t(ble::millisecond_t(m_AdvertisingIntervalMs))
+        );
+
+#if MBED_CONF_APP_PRIVACY
+        /* with privacy enabled a random own address is the resolvable
+         * private address the stack maintains */
+        parameters.setOwnAddressType(ble::own_address_type_t::RANDOM);
+#endif
+
+#if MBED_CONF_APP_HEALTH_COUNTERS
+        /* counted by onScanRequestReceived() */
+        parameters.setScanRequestNotification(true);
+#endif
+
+        return parameters;
+    }
+
+    // Adaptive Advertising Interval
+    //
+    // Controllers refuse new parameters for an advertising set that is
+    // enabled, so an interval change pauses the set, and onAdvertisingEnd()
+    // reconfigures and resumes it. The set, its payload and any periodic
+    // train attached to it are left in place throughout.
+
+    /** Feed the scheduler with whether the payload changed this cycle. */
+    void update_advertising_interval()
+    {
+        const bool changed = m_PayloadChanged;
+        m_PayloadChanged   = false;
+
+        if (m_AdaptiveInterval)
+        {
+            request_advertising_interval(m_IntervalScheduler.on_update(changed));
+        }
+    }
+
+    void request_advertising_interval(uint32_t intervalMs)
+    {
+        if (intervalMs == m_AdvertisingIntervalMs)
+        {
+            return;
+        }
+
+        m_AdvertisingIntervalMs = intervalMs;
+
+#if MBED_CONF_APP_LOW_POWER
+        /* keep the updates on the grid of the new interval. This usually
+         * runs from the update ticker itself, and a periodic event
+         * cancelled from its own callback is freed without cancel()
+         * saying so, so the ticker is replaced from an event of its own */
+        if (m_LowPowerUpdateTicker && !m_LowPowerReschedulePending)
+        {
+            const int id = m_SharedEventQueue.call("low power reschedule", [this]()
+                                                   {
+                                                       m_LowPowerReschedulePending = false;
+                                                       schedule_low_power_updates();
+                                                   }
+            );
+
+            m_LowPowerReschedulePending = (id != 0);
+
+            if (!id)
+            {
+                LOG_PRINTF("Error! Rescheduling the payload updates failed: \
+                    [%d] -> %s\r\n", BLE_ERROR_NO_MEM, ToString(BLE_ERROR_NO_MEM));
+            }
+        }
+#endif
+
+        /* a restart already on its way picks up the latest interval, as
+         * does resuming advertising once a connection stopped it */
+        if (m_IntervalChangePending || is_advertising_suspended())
+        {
+            return;
+        }
+
+        ble_error_t error = m_BluetoothLowEnergyStack.gap().stopAdvertising(m_AdvertisingHandle);
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gap().stopAdvertising() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+            return;
+        }
+
+        m_IntervalChangePending = true;
+    }
+
+    void onAdvertisingEnd(const ble::AdvertisingEndEvent &event) override
+    {
+        if (event.getAdvHandle() != m_AdvertisingHandle)
+        {
+            return;
+        }
+
+#if MBED_CONF_APP_HEALTH_COUNTERS
+        m_HealthCounters.on_advertising_ended(uptime_ms());
+#endif
+
+#if MBED_CONF_APP_CONNECTABLE
+        /* a connection ended it, before or instead of a pending restart */
+        if (event.isConnected())
+        {
+            m_IntervalChangePending        = false;
+            m_AdvertisingEndedByConnection = true;
+            resume_advertising_while_connected();
+            return;
+        }
+#endif
+
+        if (!m_IntervalChangePending)
+        {
+            return;
+        }
+
+        m_IntervalChangePending = false;
+
+        resume_advertising();
+    }
+
+    /** Restart the advertising set with the latest parameters. */
+    ble_error_t resume_advertising()
+    {
+        ble::AdvertisingParameters advertisingParameters = make_advertising_parameters();
+        ble_error_t error = configure_advertising_set(advertisingParameters);
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gap().setAdvertisingParameters() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+
+        /* resume even if the old parameters had to stay */
+        error = PROFILED_CALL(START_ADVERTISING,
+                    m_BluetoothLowEnergyStack.gap().startAdvertising(m_AdvertisingHandle));
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gap().startAdvertising() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+#if MBED_CONF_APP_HEALTH_COUNTERS
+        else
+        {
+            m_HealthCounters.on_advertising_started(uptime_ms(), m_AdvertisingIntervalMs);
+        }
+#endif
+
+        return error;
+    }
+
+    /** True while a connection keeps the advertising set from running. */
+    bool is_advertising_suspended() const
+    {
+#if MBED_CONF_APP_CONNECTABLE
+        return m_AdvertisingEndedByConnection || (m_Connected && !m_AdvertisingWhileConnected);
+#else
+        return false;
+#endif
+    }
+
+#if MBED_CONF_APP_CONNECTABLE
+    // Connections
+    //
+    // Connectable advertising stops once a central connects. The client
+    // then reads the Battery Level, or subscribes to the telemetry
+    // characteristic, which is fed at app.telemetry-sample-interval-ms for
+    // as long as the connection lasts.
+    //
+    // Scanners still see the device meanwhile: the set is restarted
+    // non-connectable as soon as both the end of advertising and the
+    // connection are reported, whichever comes last, and goes back to
+    // connectable after the disconnection. The controller then interleaves
+    // advertising events with connection events. Payload updates and
+    // telemetry samples (and with them the notification bursts) are held
+    // back to the quiet part of each connection interval, see
+    // ConnectionEventScheduler, and the central is not let below
+    // app.connection-interval-min-ms, which would leave too little air time
+    // between connection events for the advertising events.
+    //
+    // The larger ATT_MTU that batching relies on has to be agreed with the
+    // client. A client may start the exchange itself, and if it does not
+    // the server asks through the GATT client role. Longer link layer
+    // packets (Data Length Extension) are negotiated by Cordio, up to what
+    // cordio.rx-acl-buffer-size allows; onDataLengthChange() only reports
+    // the outcome.
+
+    void onConnectionComplete(const ble::ConnectionCompleteEvent &event) override
+    {
+        if (event.getStatus() != BLE_ERROR_NONE)
+        {
+            LOG_PRINTF("Error! Connection failed: \
+                [%d] -> %s\r\n", event.getStatus(), ToString(event.getStatus()));
+            m_AdvertisingEndedByConnection = false;
+            resume_advertising();
+            return;
+        }
+
+        m_Connected = true;
+        m_TelemetryServer.on_connected();
+        m_ConnectionEventScheduler.set_interval_us(connection_interval_us(event.getConnectionInterval()));
+        resume_advertising_while_connected();
+
+#if BLE_FEATURE_GATT_CLIENT
+        ble_error_t error = m_BluetoothLowEnergyStack.gattClient().negotiateAttMtu(event.getConnectionHandle());
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gattClient().negotiateAttMtu() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+#endif
+
+        m_TelemetryTicker = m_SharedEventQueue.call_every("telemetry", std::chrono::milliseconds(MBED_CONF_APP_TELEMETRY_SAMPLE_INTERVAL_MS), [this]()
+                                                          {
+                                                              run_between_connection_events("telemetry", [this]()
+                                                                                                         {
+                                                                                                             sample_telemetry();
+                                                                                                         }
+                                                              );
+                                                          }
+        );
+    }
+
+    void onDisconnectionComplete(const ble::DisconnectionCompleteEvent &) override
+    {
+        m_Connected = false;
+        m_ConnectionEventScheduler.on_disconnected();
+
+        m_SharedEventQueue.cancel(m_TelemetryTicker);
+        m_TelemetryTicker = 0;
+
+        LOG_PRINTF("Disconnected after %lu telemetry notifications at ATT_MTU %u, %lu samples dropped\r\n",
+                   static_cast<unsigned long>(m_TelemetryServer.notifications()),
+                   m_TelemetryServer.att_mtu(),
+                   static_cast<unsigned long>(m_TelemetryServer.dropped_samples()));
+
+        resume_connectable_advertising();
+    }
+
+    /** Restart the set for as long as the connection lasts, once the
+     *  connection has both ended advertising and been reported. */
+    void resume_advertising_while_connected()
+    {
+        if (!m_Connected || !m_AdvertisingEndedByConnection)
+        {
+            return;
+        }
+
+        m_AdvertisingEndedByConnection = false;
+        m_AdvertisingWhileConnected    = (resume_advertising() == BLE_ERROR_NONE);
+    }
+
+    /** Let centrals connect again, after the disconnection. */
+    void resume_connectable_advertising()
+    {
+        const bool running          = m_AdvertisingWhileConnected;
+        m_AdvertisingWhileConnected = false;
+
+        /* a pending restart picks up the connectable parameters, as does
+         * the end of the non-connectable set still running */
+        if (m_IntervalChangePending)
+        {
+            return;
+        }
+
+        if (running)
+        {
+            ble_error_t error = m_BluetoothLowEnergyStack.gap().stopAdvertising(m_AdvertisingHandle);
+
+            if (!error)
+            {
+                m_IntervalChangePending = true;
+                return;
+            }
+
+            LOG_PRINTF("Error! _ble.gap().stopAdvertising() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+
+        m_AdvertisingEndedByConnection = false;
+        resume_advertising();
+    }
+
+    void onUpdateConnectionParametersRequest(const ble::UpdateConnectionParametersRequestEvent &event) override
+    {
+        const ble::conn_interval_t floor(ble::millisecond_t(MBED_CONF_APP_CONNECTION_INTERVAL_MIN_MS));
+
+        ble::conn_interval_t minInterval = event.getMinConnectionInterval();
+        ble::conn_interval_t maxInterval = event.getMaxConnectionInterval();
+
+        if (minInterval.value() < floor.value())
+        {
+            minInterval = floor;
+        }
+
+        if (maxInterval.value() < minInterval.value())
+        {
+            maxInterval = minInterval;
+        }
+
+        /* the supervision timeout must exceed (1 + latency) * interval * 2,
+         * lest the link drop on a couple of missed events; if raising the
+         * interval breaks that rule, the central's own values stand */
+        const uint32_t timeoutUs = event.getSupervisionTimeout().value() * 10000UL;
+
+        if (timeoutUs <= (1UL + event.getSlaveLatency().value()) * connection_interval_us(maxInterval) * 2)
+        {
+            minInterval = event.getMinConnectionInterval();
+            maxInterval = event.getMaxConnectionInterval();
+        }
+
+        ble_error_t error = m_BluetoothLowEnergyStack.gap().acceptConnectionParametersUpdate(
+                                event.getConnectionHandle(),
+                                minInterval,
+                                maxInterval,
+                                event.getSlaveLatency(),
+                                event.getSupervisionTimeout());
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gap().acceptConnectionParametersUpdate() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+    }
+
+    void onConnectionParametersUpdateComplete(const ble::ConnectionParametersUpdateCompleteEvent &event) override
+    {
+        if (event.getStatus() != BLE_ERROR_NONE)
+        {
+            return;
+        }
+
+        m_ConnectionEventScheduler.set_interval_us(connection_interval_us(event.getConnectionInterval()));
+    }
+
+    void on_connection_event()
+    {
+        m_ConnectionEventScheduler.on_connection_event(us_ticker_read());
+    }
+
+    static uint32_t connection_interval_us(const ble::conn_interval_t &interval)
+    {
+        // The interval counts 1.25 ms units.
+        return interval.value() * 1250UL;
+    }
+
+    void onDataLengthChange(ble::connection_handle_t, uint16_t txSize, uint16_t rxSize) override
+    {
+        LOG_PRINTF("Link layer data length now %u bytes out, %u bytes in\r\n", txSize, rxSize);
+    }
+
+    /** Hand the latest values of the advertised fields to a subscribed
+     *  client. The fields are read on the sampling schedule of the payload
+     *  only, reading them again here would run their sources, such as the
+     *  simulated battery, at the telemetry rate. */
+    void sample_telemetry()
+    {
+        if (!m_TelemetryServer.wants_samples())
+        {
+            return;
+        }
+
+        uint8_t sample[MBED_CONF_APP_MAX_ADVERTISED_FIELDS * AdvertisedFieldBase::MAX_ENCODED_SIZE];
+
+        m_AdvertisedFields.encode_to(sample);
+
+        ble_error_t error = m_TelemetryServer.push_sample(
+                                mbed::make_const_Span(sample, m_TelemetryServer.sample_size()));
+
+        if (error)
+        {
+            LOG_PRINTF("Error! Notifying telemetry failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+    }
+#endif
+
+#if MBED_CONF_APP_OBSERVER
+    // Observer
+    //
+    // Gateways listen as well as broadcast. Scanning is passive, so the
+    // reports are the advertising payloads themselves and never scan
+    // responses, which would look like a peer changing its payload back
+    // and forth. Duplicate filtering in the controller is off: it goes by
+    // peer address alone and would hide payload changes. Repeats are
+    // dropped by m_ReportCache instead, on arrival and in constant time,
+    // and only the reports left go on to the hook or get printed. Printing
+    // every report would swamp the console, and the event queue with it,
+    // within seconds in a dense deployment.
+    //
+    // The controller fits the advertising events of the set in between
+    // scan windows, even at a 100% scan duty cycle.
+
+    void start_observing()
+    {
+        ble::ScanParameters scanParameters(
+            ble::phy_t::LE_1M,
+            ble::scan_interval_t(ble::millisecond_t(MBED_CONF_APP_OBSERVER_SCAN_INTERVAL_MS)),
+            ble::scan_window_t(ble::millisecond_t(MBED_CONF_APP_OBSERVER_SCAN_WINDOW_MS)),
+            false /* passive */
+        );
+
+        ble_error_t error = m_BluetoothLowEnergyStack.gap().setScanParameters(scanParameters);
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gap().setScanParameters() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+            return;
+        }
+
+        error = m_BluetoothLowEnergyStack.gap().startScan(ble::scan_duration_t::forever(),
+                                                          ble::duplicates_filter_t::DISABLE);
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gap().startScan() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+            return;
+        }
+
+        if (MBED_CONF_APP_OBSERVER_REPORT_INTERVAL_MS > 0)
+        {
+            m_SharedEventQueue.call_every("observer report", std::chrono::milliseconds(MBED_CONF_APP_OBSERVER_REPORT_INTERVAL_MS), [this]()
+                                                  {
+                                                      print_observer_statistics();
+                                                  }
+            );
+        }
+    }
+
+    void onAdvertisingReport(const ble::AdvertisingReportEvent &event) override
+    {
+        if (!m_ReportCache.insert(event.getPeerAddress().data(),
+                                  static_cast<uint8_t>(event.getPeerAddressType().value()),
+                                  event.getPayload()))
+        {
+            return;
+        }
+
+        if (m_ObservedReportHook)
+        {
+            m_ObservedReportHook(event);
+            return;
+        }
+
+        /* addresses are stored least significant byte first, and go out
+         * in two halves to stay within what a deferred log entry holds */
+        const uint8_t *address = event.getPeerAddress().data();
+
+        LOG_PRINTF("Observed %04x%08lx at %d dBm, %u byte payload\r\n",
+                   static_cast<unsigned>(address[5] << 8 | address[4]),
+                   static_cast<unsigned long>(address[3]) << 24 | address[2] << 16 | address[1] << 8 | address[0],
+                   event.getRssi(), static_cast<unsigned>(event.getPayload().size()));
+    }
+
+    void print_observer_statistics() const
+    {
+        const uint32_t lookups    = m_ReportCache.lookups();
+        const uint32_t duplicates = m_ReportCache.duplicates();
+
+        LOG_PRINTF("Observer: %lu reports, %lu duplicates dropped, %lu forwarded, %lu cache evictions\r\n",
+                   static_cast<unsigned long>(lookups),
+                   static_cast<unsigned long>(duplicates),
+                   static_cast<unsigned long>(lookups - duplicates),
+                   static_cast<unsigned long>(m_ReportCache.evictions()));
+    }
+#endif
+
+#if MBED_CONF_APP_PRIVACY
+    // Privacy
+    //
+    // The set advertises from a resolvable private address, which only
+    // peers holding this device's identity resolving key (IRK) can tell
+    // belongs to it. The stack generates the address and renews it every
+    // app.privacy-rotation-interval-s; the Gap API neither takes an address
+    // from the application nor reports when it changes. Non-resolvable
+    // addresses would leave nobody able to recognise the unit, hence
+    // resolvable ones.
+    //
+    // The IRK comes from the security manager, which is set up without
+    // bonding since nothing is paired with.
+    //
+    // With app.unit-name the name would give the unit away regardless, so
+    // its digits are a random ID instead, see PrivateUnitIdRotation. An ID
+    // outliving its address, or the other way round, would link the two,
+    // so the ID rotates at the address timeout, on a ticker started when
+    // onPrivacyEnabled() reports the first address, i.e. when the stack
+    // starts its own timer. The set keeps advertising throughout: the
+    // prepared ID is committed at the deadline like any payload update.
+    // The two timers run off different clocks, so the ID may change up to
+    // their drift apart from the address. Fixed identifiers are kept off
+    // the air altogether, i.e. the iBeacon and Eddystone-UID frames of
+    // app.beacon-rotation.
+
+    void enable_privacy()
+    {
+        ble_error_t error = m_BluetoothLowEnergyStack.securityManager().init(
+                                false /* bonding */,
+                                false /* MITM */,
+                                ble::SecurityManager::IO_CAPS_NONE,
+                                nullptr /* passkey */,
+                                false /* signing */);
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.securityManager().init() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+            return;
+        }
+
+        const ble::peripheral_privacy_configuration_t configuration = {
+            false /* resolvable rather than non-resolvable addresses */,
+            ble::peripheral_privacy_configuration_t::DO_NOT_RESOLVE
+        };
+
+        error = m_BluetoothLowEnergyStack.gap().setPeripheralPrivacyConfiguration(&configuration);
+
+        /* the address is renewed on the deadline of the unit ID */
+        if (!error)
+        {
+            error = m_BluetoothLowEnergyStack.gap().setPrivateAddressTimeout(MBED_CONF_APP_PRIVACY_ROTATION_INTERVAL_S);
+        }
+
+        if (!error)
+        {
+            error = m_BluetoothLowEnergyStack.gap().enablePrivacy(true);
+        }
+
+        if (error)
+        {
+            LOG_PRINTF("Error! _ble.gap().enablePrivacy() failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+    }
+#endif
+
+#if PRIVATE_UNIT_ID_ENABLED
+    /** The first address is in place and the stack's address timer runs,
+     *  so the ID rotation starts running alongside it. */
+    void onPrivacyEnabled() override
+    {
+        if (m_UnitIdRotationScheduled)
+        {
+            return;
+        }
+
+        m_UnitIdRotationScheduled = true;
+        schedule_private_unit_id_rotation();
+    }
+
+    void schedule_private_unit_id_rotation()
+    {
+        /* the first ID went into the payload as it was built, draw the next */
+        m_PrivateUnitId.prepare();
+
+        const int id = m_SharedEventQueue.call_every("unit id rotation", std::chrono::seconds(MBED_CONF_APP_PRIVACY_ROTATION_INTERVAL_S), [this]()
+                                                     {
+                                                         rotate_private_unit_id();
+                                                     }
+        );
+
+        if (!id)
+        {
+            LOG_PRINTF("Error! Scheduling the private unit ID rotation failed: \
+                [%d] -> %s\r\n", BLE_ERROR_NO_MEM, ToString(BLE_ERROR_NO_MEM));
+        }
+    }
+
+    /** Switch the payload over to the prepared ID, then prepare the next. */
+    void rotate_private_unit_id()
+    {
+        /* the TRNG failed last time, a late ID beats keeping the old one */
+        if (!m_PrivateUnitId.is_prepared() && !m_PrivateUnitId.prepare())
+        {
+            LOG_PRINTF("Error! No private unit ID to rotate to: \
+                [%d] -> %s\r\n", BLE_ERROR_UNSPECIFIED, ToString(BLE_ERROR_UNSPECIFIED));
+            return;
+        }
+
+        const auto digits = mbed::make_const_Span(reinterpret_cast<const uint8_t *>(m_PrivateUnitId.next_digits()),
+                                                  UNIT_ID_DIGITS);
+
+        m_PrivateUnitId.on_switch_started(us_ticker_read());
+        memcpy(&m_UnitName[NameStructure_t::digits_offset()], digits.data(), UNIT_ID_DIGITS);
+
+        begin_payload_update();
+
+        if (m_UnitIdField.is_bound())
+        {
+            m_UnitIdField.patch(m_AdvertisingBuffer, digits);
+        }
+
+        ble_error_t error = commit_payload_update();
+
+        if (error)
+        {
+            LOG_PRINTF("Error! Rotating the private unit ID failed: \
+                [%d] -> %s\r\n", error, ToString(error));
+        }
+
+        m_PrivateUnitId.prepare();
+    }
+
+    /** Account for the payload the controller just took. */
+    void on_private_unit_id_committed(mbed::Span<const uint8_t> payload)
+    {
+        /* a beacon frame going out does not carry the ID */
+        if (!m_PrivateUnitId.is_switch_pending() || (payload.data() != m_AdvertisingBuffer))
+        {
+            return;
+        }
+
+        m_PrivateUnitId.on_switch_committed(us_ticker_read());
+
+        LOG_PRINTF("Private unit ID rotation %lu took %lu us, %lu us at most\r\n",
+                   static_cast<unsigned long>(m_PrivateUnitId.rotations()),
+                   static_cast<unsigned long>(m_PrivateUnitId.last_latency_us()),
+                   static_cast<unsigned long>(m_PrivateUnitId.max_latency_us()));
+    }
+#endif
+
+    /** True when the application asked for extended advertising and the
+     *  controller is able to provide it. */
+    bool is_extended_advertising_available()
+    {
+#if EXTENDED_ADVERTISING_ENABLED
+        return m_BluetoothLowEnergyStack.gap().isFeatureSupported(
+                   ble::controller_supported_features_t::LE_EXTENDED_ADVERTISING
+               );
+#else
+        return false;
+#endif
+    }
+
+    /** Bytes of m_AdvertisingBuffer usable by an extended advertising set. */
+    size_t extended_advertising_capacity()
+    {
+        const size_t controllerLimit = m_BluetoothLowEnergyStack.gap().getMaxAdvertisingDataLength();
+
+        return (controllerLimit < ADVERTISING_BUFFER_SIZE) ? controllerLimit
+                                                           : ADVERTISING_BUFFER_SIZE;
+    }
+
+    /** Apply parameters to the advertising set used for m_AdvertisingBuffer.
+     *  In extended mode a dedicated set is created and the builder is given
+     *  as much of the buffer as the controller will accept in one set. */
+    ble_error_t configure_advertising_set(ble::AdvertisingParameters &parameters)
+    {
+#if EXTENDED_ADVERTISING_ENABLED
+        if (m_ExtendedAdvertising)
+        {
+            parameters.setUseLegacyPDU(false);
+
+            if (m_AdvertisingHandle == ble::LEGACY_ADVERTISING_HANDLE)
+            {
+                ble_error_t error = m_BluetoothLowEnergyStack.gap().createAdvertisingSet(
+                                        &m_AdvertisingHandle,
+                                        parameters
+                                    );
+
+                if (error)
+                {
+                    m_AdvertisingHandle = ble::LEGACY_ADVERTISING_HANDLE;
+                }
+
+                return error;
+            }
+
+            return PROFILED_CALL(SET_ADVERTISING_PARAMETERS,
+                       m_BluetoothLowEnergyStack.gap().setAdvertisingParameters(
+                           m_AdvertisingHandle,
+                           parameters
+                       )
+                   );
+        }
+#endif
+
+        return PROFILED_CALL(SET_ADVERTISING_PARAMETERS,
+                   m_BluetoothLowEnergyStack.gap().setAdvertisingParameters(
+                       m_AdvertisingHandle,
+                       parameters
+                   )
+               );
+    }
+
+    /** Hand the scan response to the controller, unless that is what it
+     *  already holds. Payload updates never come through here. */
+    ble_error_t commit_scan_response()
+    {
+        if (m_CommittedScanResponse.matches(m_ScanResponse))
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t error = PROFILED_CALL(SET_ADVERTISING_SCAN_RESPONSE,
+                                m_BluetoothLowEnergyStack.gap().setAdvertisingScanResponse(
+                                    m_AdvertisingHandle,
+                                    m_ScanResponse
+                                )
+                            );
+
+        if (!error)
+        {
+            m_CommittedScanResponse.record(m_ScanResponse);
+        }
+
+        return error;
+    }
+
+    /** Hand the current contents of m_AdvertisingBuffer to the controller,
+     *  unless they are what the controller already holds or the previous
+     *  write was too recent, in which case a single deferred write picks up
+     *  every change made in the meantime. The first write always goes
+     *  straight through. A write the stack has no room for
+     *  is retried from on_ble_events_processed() rather than reported.
+     *  Inside a payload transaction this does nothing;
+     *  commit_payload_update() calls back in once it closes. */
+    ble_error_t commit_advertising_payload()
+    {
+        if (m_PayloadUpdateDepth > 0)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        const auto payload = advertising_payload();
+
+        if (m_CommittedPayload.matches(payload))
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        m_PayloadChanged = true;
+
+        const auto now     = rtos::Kernel::Clock::now();
+        const auto elapsed = now - m_LastCommitTime;
+
+        /* a default m_LastCommitTime means nothing was committed yet, and
+         * the first payload must not wait, or advertising would start
+         * out with an empty one */
+        if ((m_LastCommitTime != rtos::Kernel::Clock::time_point()) && (elapsed < m_MinimumCommitInterval))
+        {
+            if (!m_DeferredCommitPending)
+            {
+                m_DeferredCommitPending = true;
+
+                const int id = m_SharedEventQueue.call_in("payload commit", m_MinimumCommitInterval - elapsed, [this]()
+                                                          {
+                                                              m_DeferredCommitPending = false;
+
+                                                              ble_error_t error = commit_advertising_payload();
+                                                              if (error)
+                                                              {
+                                                                  LOG_PRINTF("Error! deferred _ble.gap().setAdvertisingPayload() failed: \
+                                                                      [%d] -> %s\r\n", error, ToString(error));
+                                                              }
+                                                          }
+                );
+
+                if (!id)
+                {
+                    m_DeferredCommitPending = false;
+                    return BLE_ERROR_NO_MEM;
+                }
+            }
+
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t error = PROFILED_CALL(SET_ADVERTISING_PAYLOAD,
+                                m_BluetoothLowEnergyStack.gap().setAdvertisingPayload(
+                                    m_AdvertisingHandle,
+                                    payload
+                                )
+                            );
+
+#if MBED_CONF_APP_HEALTH_COUNTERS
+        if (!error)
+        {
+            m_HealthCounters.on_payload_committed();
+        }
+        else
+        {
+            m_HealthCounters.on_payload_commit_failed(error);
+        }
+#endif
+
+        if (!error)
+        {
+            m_CommittedPayload.record(payload);
+            m_LastCommitTime = now;
+
+#if PRIVATE_UNIT_ID_ENABLED
+            on_private_unit_id_committed(payload);
+#endif
+        }
+        else if (is_retryable(error))
+        {
+            m_CommitRetryPending = true;
+            return BLE_ERROR_NONE;
+        }
+
+        return error;
+    }
+
+    /** Errors that only say the stack has no room for the write right now. */
+    static bool is_retryable(ble_error_t error)
+    {
+        return (error == BLE_STACK_BUSY) || (error == BLE_ERROR_NO_MEM);
+    }
+
+#if PERIODIC_ADVERTISING_ENABLED
+    // Periodic Advertising
+    //
+    // A periodic advertising train hangs off a non-connectable,
+    // non-scannable extended advertising set. Its packets go out on the
+    // secondary channels at a fixed interval. A scanner that has
+    // synchronised once (using the SyncInfo field in the extended set)
+    // then receives every packet at a known time, with no scan requests
+    // and far lower latency than catching the next ordinary advertisement.
+    // Here the train carries the telemetry, i.e. the battery level.
+
+    /** Build the periodic payload and start the train on m_AdvertisingHandle. */
+    ble_error_t start_periodic_advertising()
+    {
+        ble::Gap &gap = m_BluetoothLowEnergyStack.gap();
+
+        const size_t controllerLimit = gap.getMaxAdvertisingDataLength();
+        m_PeriodicAdvertisingDataBuilder = ble::AdvertisingDataBuilder(
+                                               m_PeriodicAdvertisingBuffer,
+                                               (controllerLimit < PERIODIC_ADVERTISING_BUFFER_SIZE)
+                                               ? controllerLimit : PERIODIC_ADVERTISING_BUFFER_SIZE
+                                           );
+
+        ble_error_t error = add_advertised_fields(m_PeriodicAdvertisingDataBuilder);
+
+        if (!error)
+        {
+            error = bind_advertised_fields(m_PeriodicAdvertisingDataBuilder.getAdvertisingData(),
+                                           m_PeriodicAdvertisingBuffer);
+        }
+
+        if (error)
+        {
+            return error;
+        }
+
+        const ble::periodic_interval_t interval(
+            ble::millisecond_t(MBED_CONF_APP_PERIODIC_ADVERTISING_INTERVAL_MS)
+        );
+
+        error = gap.setPeriodicAdvertisingParameters(m_AdvertisingHandle, interval, interval);
+
+        if (error)
+        {
+            return error;
+        }
+
+        m_PeriodicAdvertising = true;
+        m_CommittedPeriodicPayload.invalidate();
+
+        error = commit_periodic_advertising_payload();
+
+        if (!error)
+        {
+            error = gap.startPeriodicAdvertising(m_AdvertisingHandle);
+        }
+
+        if (error)
+        {
+            m_PeriodicAdvertising = false;
+        }
+
+        return error;
+    }
+
+    /** Hand the periodic payload to the controller unless it is unchanged.
+     *  Like commit_advertising_payload() this waits for open transactions. */
+    ble_error_t commit_periodic_advertising_payload()
+    {
+        if (!m_PeriodicAdvertising || (m_PayloadUpdateDepth > 0))
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        const auto payload = m_PeriodicAdvertisingDataBuilder.getAdvertisingData();
+
+        if (m_CommittedPeriodicPayload.matches(payload))
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        ble_error_t error = PROFILED_CALL(SET_PERIODIC_ADVERTISING_PAYLOAD,
+                                m_BluetoothLowEnergyStack.gap().setPeriodicAdvertisingPayload(
+                                    m_AdvertisingHandle,
+                                    payload
+                                )
+                            );
+
+        if (!error)
+        {
+            m_CommittedPeriodicPayload.record(payload);
+        }
+        else if (is_retryable(error))
+        {
+            m_CommitRetryPending = true;
+            return BLE_ERROR_NONE;
+        }
+
+        return error;
+    }
+#endif
+
+private:
+    // The Cordio Bluetooth stack only stores one single signing key. This key is then 
+    // shared across all bonded devices. If a malicious device bonds with the Mbed OS 
+    // application it then gains knowledge of the shared signing key of the Mbed OS device. 
+    // The malicious device can then track the Mbed OS device whenever a signing write 
+    // is issued from it. 
+    // 
+    // To overcome this privacy issue do not issue signed writes from the Mbed OS device.
+    // A signed write occurs when the member function `write` of `GattClient` is called 
+    // with its `cmd` argument set to `GATT_OP_SIGNED_WRITE_CMD`.
+    // 
+    // Instead of using signed writes, enable encryption on the connection. This is achieved
+    // by calling the function `setLinkEncryption` of the `SecurityManager`. Set the encryption 
+    // to at least `ENCRYPTED`. 
+    BLE &                       m_BluetoothLowEnergyStack;
+    
+    EventQueue_t &              m_SharedEventQueue;
+    uint8_t                     m_TheBatteryLevel; // The data to be broadcasted in the BLE advertisements.
+
+    // The battery, simulated unless app.dma-sampling, as an advertised sensor, and every field
+    // advertised, each written straight into its slots of the payloads.
+    AdvertisedField<uint8_t>    m_BatteryLevel;
+#if MBED_CONF_APP_DMA_SAMPLING
+    BatterySampler_t            m_BatterySampler;
+#endif
+    AdvertisedFieldRegistry<MBED_CONF_APP_MAX_ADVERTISED_FIELDS> m_AdvertisedFields;
+
+    // Set carrying m_AdvertisingBuffer; the legacy set unless an extended
+    // one could be created.
+    ble::advertising_handle_t   m_AdvertisingHandle;
+    bool                        m_ExtendedAdvertising;
+    
+    // Leverage C++11 member initializers to guarantee that the buffer 
+    // is zeroed out upon construction before passing it on to the DataBuilder.
+    uint8_t                     m_AdvertisingBuffer[ADVERTISING_BUFFER_SIZE] = {};
+    ble::AdvertisingDataBuilder m_AdvertisingDataBuilder;
+    mbed::Span<const uint8_t>   m_AdvertisingPayload; // What goes out, m_AdvertisingBuffer unless rotating.
+
+    // The legacy scan response, kept apart from the advertising payload so
+    // that neither has to be rebuilt when the other one changes. It points
+    // at the flash image until the application sets its own.
+    uint8_t                     m_ScanResponseBuffer[ble::LEGACY_ADVERTISING_MAX_SIZE] = {};
+    ble::AdvertisingDataBuilder m_ScanResponseDataBuilder;
+    mbed::Span<const uint8_t>   m_ScanResponse;
+    CommittedPayloadShadow<ble::LEGACY_ADVERTISING_MAX_SIZE> m_CommittedScanResponse;
+
+    // What the controller currently holds, so that redundant HCI writes
+    // can be skipped, the pacing state for coalescing bursts of writes and
+    // whether a write the stack had no room for awaits another attempt.
+    CommittedPayloadShadow<ADVERTISING_BUFFER_SIZE>          m_CommittedPayload;
+    rtos::Kernel::Clock::duration                             m_MinimumCommitInterval;
+    rtos::Kernel::Clock::time_point                           m_LastCommitTime;
+    bool                                                      m_DeferredCommitPending;
+    bool                                                      m_CommitRetryPending;
+
+    // Nesting depth of begin_payload_update()/commit_payload_update().
+    uint8_t                                                   m_PayloadUpdateDepth;
+
+    // Advertising interval currently asked for and the adaptive scheduler
+    // that moves it when m_AdaptiveInterval is set.
+    AdaptiveIntervalScheduler                                 m_IntervalScheduler;
+    bool                                                      m_AdaptiveInterval;
+    uint32_t                                                  m_AdvertisingIntervalMs;
+    bool                                                      m_IntervalChangePending;
+    bool                                                      m_PayloadChanged;
+
+#if MBED_CONF_APP_UNIT_NAME
+    // The prefix and digits of the name, null terminated for setName().
+    char                        m_UnitName[NameStructure_t::data_size() + 1] = {};
+#endif
+
+#if MBED_CONF_APP_COMPACT_TELEMETRY
+    // The channels sent in the scan response and where their readings
+    // come from.
+    CompactTelemetryEncoder_t   m_CompactTelemetry;
+    mbed::Callback<int32_t()>   m_CompactTelemetrySources[MBED_CONF_APP_COMPACT_TELEMETRY_MAX_CHANNELS];
+#endif
+
+#if PRIVATE_UNIT_ID_ENABLED
+    // The ID the next rotation switches to, the rotation latency, where
+    // the digits of the name sit in m_AdvertisingBuffer and whether the
+    // rotation ticker runs.
+    PrivateUnitIdRotation<UNIT_ID_DIGITS> m_PrivateUnitId;
+    PatchableAdvertisingField   m_UnitIdField;
+    bool                        m_UnitIdRotationScheduled = false;
+#endif
+
+    mbed::Callback<void()>      m_FirstAdvertisementHook;
+    bool                        m_FirstAdvertisementStarted = false;
+
+#if MBED_CONF_APP_BEACON_ROTATION
+    // The frames rotated through, indexed by BeaconFormat_t, the one being
+    // advertised and the RAM copies of the frames that change.
+    mbed::Span<const uint8_t>   m_BeaconFrames[BEACON_FORMAT_COUNT];
+    unsigned                    m_BeaconFormat = BEACON_FORMAT_CUSTOM;
+    uint8_t                     m_EddystoneTlmFrame[sizeof(gs_EddystoneTlmImage.m_Bytes)] = {};
+#if DIAGNOSTICS_FRAME_ENABLED
+    uint8_t                     m_DiagnosticsFrame[sizeof(gs_DiagnosticsImage.m_Bytes)] = {};
+#endif
+#endif
+
+#if MBED_CONF_APP_HEALTH_COUNTERS
+    HealthCounters_t            m_HealthCounters;
+#endif
+
+#if MBED_CONF_APP_CONNECTABLE
+    // The GATT services, whether a central is connected and the ticker
+    // sampling telemetry while it is.
+    TelemetryGattServer         m_TelemetryServer;
+    bool                        m_Connected = false;
+    int                         m_TelemetryTicker = 0;
+    ConnectionEventScheduler    m_ConnectionEventScheduler;
+    bool                        m_AdvertisingEndedByConnection = false;
+    bool                        m_AdvertisingWhileConnected = false;
+#endif
+
+#if MBED_CONF_APP_OBSERVER
+    // Reports seen lately and where the others go.
+    AdvertisingReportCache<MBED_CONF_APP_OBSERVER_CACHE_SIZE> m_ReportCache;
+    mbed::Callback<void(const ble::AdvertisingReportEvent &)> m_ObservedReportHook;
+#endif
+
+#if MBED_CONF_APP_LOW_POWER
+    // The ticker sampling and updating the payload, its period and whether
+    // replacing it for a new period is under way.
+    int                         m_LowPowerUpdateTicker = 0;
+    uint32_t                    m_LowPowerUpdatePeriodMs = 0;
+    bool                        m_LowPowerReschedulePending = false;
+#endif
+
+#if MBED_CONF_APP_THROUGHPUT_BENCHMARK
+    // Results of the ramp, the ticker driving its current step and when
+    // that step started.
+    ThroughputBenchmark         m_ThroughputBenchmark{MBED_CONF_APP_THROUGHPUT_BENCHMARK_START_INTERVAL_MS,
+                                                      MBED_CONF_APP_THROUGHPUT_BENCHMARK_MIN_INTERVAL_MS};
+    int                         m_ThroughputBenchmarkTicker = 0;
+    rtos::Kernel::Clock::time_point m_ThroughputBenchmarkStepStart;
+#endif
+
+#if PERIODIC_ADVERTISING_ENABLED
+    // Periodic advertising train payload, with its own builder and record
+    // of what the controller holds.
+    uint8_t                     m_PeriodicAdvertisingBuffer[PERIODIC_ADVERTISING_BUFFER_SIZE] = {};
+    ble::AdvertisingDataBuilder m_PeriodicAdvertisingDataBuilder{m_PeriodicAdvertisingBuffer};
+    CommittedPayloadShadow<PERIODIC_ADVERTISING_BUFFER_SIZE> m_CommittedPeriodicPayload;
+    bool                        m_PeriodicAdvertising = false;
+#endif
+};
@@ -0,0 +1,132 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include "platform/mbed_toolchain.h"
+#include "rtos/Kernel.h"
+
+// Time from reset to the first advertisement, carried over to the next boot.
+//
+// Reporting the time it took to boot would itself slow the boot down,
+// since printing at 9600 baud takes tens of milliseconds. So each
+// milestone is stamped in RAM as it is reached and, once advertising is
+// up, the stamps are kept in a record that the C runtime leaves alone at
+// reset. The next boot prints the record. It is checked against a magic
+// word and a check sum, so RAM contents after a power cycle are not
+// mistaken for a record.
+//
+// Stamps are the RTOS kernel clock, which starts just after the clocks
+// and the C runtime are set up, i.e. the little time spent before that is
+// not included. The advertising milestone is startAdvertising() returning;
+// the first PDU follows within one advertising interval.
+//
+// The record lives in app.boot-time-section, which the target's linker
+// script must exclude from zero-initialization (.noinit by default).
+class BootTimeRecord
+{
+public:
+    enum Milestone_t
+    {
+        MAIN_ENTERED,
+        BLE_INITIALIZED,
+        ADVERTISING_STARTED,
+        MILESTONE_COUNT
+    };
+
+    /** Stamp milestone with the time since boot. Reaching
+     *  ADVERTISING_STARTED keeps the stamps for the next boot. */
+    static void mark(Milestone_t milestone)
+    {
+        Times_t &current = current_boot();
+
+        current.m_Milliseconds[milestone] = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                rtos::Kernel::Clock::now().time_since_epoch()).count());
+
+        if (milestone == ADVERTISING_STARTED)
+        {
+            Record_t &record = retained();
+
+            record.m_Times = current;
+            record.m_Magic = MAGIC;
+            record.m_Check = check_sum(record);
+        }
+    }
+
+    /** Take the record left by the previous boot. Returns false if there is
+     *  none, i.e. after a power cycle or when that boot never got to
+     *  advertise. Either way the record is consumed. */
+    static bool take_previous(uint32_t (&milliseconds)[MILESTONE_COUNT])
+    {
+        Record_t &record = retained();
+
+        const bool valid = (record.m_Magic == MAGIC) && (record.m_Check == check_sum(record));
+
+        if (valid)
+        {
+            for (size_t i = 0; i < MILESTONE_COUNT; ++i)
+            {
+                milliseconds[i] = record.m_Times.m_Milliseconds[i];
+            }
+        }
+
+        record.m_Magic = 0;
+
+        return valid;
+    }
+
+private:
+    static constexpr uint32_t MAGIC = 0xB007713E;
+
+    struct Times_t
+    {
+        uint32_t m_Milliseconds[MILESTONE_COUNT];
+    };
+
+    struct Record_t
+    {
+        uint32_t m_Magic;
+        Times_t  m_Times;
+        uint32_t m_Check;
+    };
+
+    static uint32_t check_sum(const Record_t &record)
+    {
+        uint32_t sum = record.m_Magic;
+
+        for (size_t i = 0; i < MILESTONE_COUNT; ++i)
+        {
+            sum = (sum << 5 | sum >> 27) ^ record.m_Times.m_Milliseconds[i];
+        }
+
+        return ~sum;
+    }
+
+    static Times_t & current_boot()
+    {
+        static Times_t times;
+        return times;
+    }
+
+    static Record_t & retained()
+    {
+        MBED_SECTION(MBED_CONF_APP_BOOT_TIME_SECTION) static Record_t record;
+        return record;
+    }
+};
@@ -0,0 +1,67 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstring>
+#include "platform/mbed_assert.h"
+#include "ble/BLE.h"
+
+// Copy of the bytes last handed to the controller for one payload.
+//
+// Pushing a payload costs an HCI command and wakes the radio core, even
+// when the bytes are identical to what the controller already holds. By
+// comparing against this shadow before every push, unchanged payloads can
+// be skipped entirely. A full copy is used rather than a hash as it costs
+// only MaxSize bytes of RAM and can never yield a false "unchanged".
+template <size_t MaxSize>
+class CommittedPayloadShadow
+{
+public:
+    CommittedPayloadShadow()
+        : m_Length(0)
+        , m_Valid(false)
+    {
+    }
+
+    /** True when payload is byte for byte what was last recorded. */
+    bool matches(mbed::Span<const uint8_t> payload) const
+    {
+        return m_Valid
+               && (payload.size() == m_Length)
+               && (memcmp(m_Bytes, payload.data(), m_Length) == 0);
+    }
+
+    /** Remember payload as the controller's current contents. */
+    void record(mbed::Span<const uint8_t> payload)
+    {
+        MBED_ASSERT(payload.size() <= MaxSize);
+        memcpy(m_Bytes, payload.data(), payload.size());
+        m_Length = payload.size();
+        m_Valid  = true;
+    }
+
+    /** Forget the recorded payload so that the next push always goes out. */
+    void invalidate()
+    {
+        m_Valid = false;
+    }
+
+private:
+    uint8_t m_Bytes[MaxSize] = {};
+    size_t  m_Length;
+    bool    m_Valid;
+};
@@ -0,0 +1,466 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "platform/Span.h"
+
+// Compact telemetry frames, for packing a run of multi-sensor readings
+// into the few bytes of a legacy manufacturer specific data field.
+//
+// A sample is one reading of every channel, each a signed fixed-point
+// integer of the channel's value width. Successive readings of a sensor
+// rarely move far, so rather than the full values a frame carries their
+// differences from a keyframe, a sample sent in full, in the channel's
+// (much narrower) delta width. A new keyframe starts every KeyframeInterval
+// samples, or as soon as a difference does not fit its width. Differences
+// are against the keyframe and not the previous sample, so a gateway that
+// missed any number of frames decodes the next one as long as it has its
+// keyframe.
+//
+// A frame holds as many of the newest samples as fit, all bit-packed,
+// and is laid out as follows:
+//
+//   offset  size
+//   0       1     bit 7: the frame starts with the keyframe
+//                 bits 0-6: number of samples
+//   1       2     sequence number of the newest sample, little-endian
+//   3       1     low 8 bits of the sequence number of the keyframe
+//   4       n     bit stream, least significant bit first:
+//                 - with bit 7 set, every channel's keyframe value, in its
+//                   value width, the first sample being the keyframe
+//                 - then for every further sample, oldest first, every
+//                   channel's difference from the keyframe, in its delta
+//                   width
+//
+// The channel widths are not in the frame; the decoder is set up with the
+// same channels as the encoder.
+//
+// E.g. the 27 bytes left of a legacy scan response after the company
+// identifier would fit 4 readings of three 16-bit channels, raw behind a
+// 16-bit sequence number. With 4-bit deltas a frame holds 15 readings, or
+// 12 when it starts with the keyframe.
+struct CompactTelemetryChannel_t
+{
+    uint8_t m_ValueBits;   // Width of a keyframe value, 2 to 32 bits.
+    uint8_t m_DeltaBits;   // Width of a difference, 1 to m_ValueBits bits.
+};
+
+namespace detail
+{
+    constexpr size_t COMPACT_TELEMETRY_HEADER_SIZE = 4;
+    constexpr uint8_t COMPACT_TELEMETRY_KEYFRAME   = 0x80;
+
+    inline bool is_valid_channel(const CompactTelemetryChannel_t &channel)
+    {
+        return (channel.m_ValueBits >= 2) && (channel.m_ValueBits <= 32)
+               && (channel.m_DeltaBits >= 1) && (channel.m_DeltaBits <= channel.m_ValueBits);
+    }
+
+    inline int64_t min_signed(unsigned bits)
+    {
+        return -(INT64_C(1) << (bits - 1));
+    }
+
+    inline int64_t max_signed(unsigned bits)
+    {
+        return (INT64_C(1) << (bits - 1)) - 1;
+    }
+
+    class TelemetryBitWriter
+    {
+    public:
+        explicit TelemetryBitWriter(mbed::Span<uint8_t> bytes)
+            : m_Bytes(bytes)
+            , m_Bit(0)
+        {
+        }
+
+        /** Append the low bits of value. The caller makes sure they fit. */
+        void write(int64_t value, unsigned bits)
+        {
+            uint64_t remaining = static_cast<uint64_t>(value);
+
+            while (bits > 0)
+            {
+                const size_t   index  = m_Bit / 8;
+                const unsigned offset = m_Bit % 8;
+                const unsigned taken  = (bits < 8 - offset) ? bits : 8 - offset;
+
+                if (offset == 0)
+                {
+                    m_Bytes[index] = 0;
+                }
+
+                m_Bytes[index] |= static_cast<uint8_t>((remaining & ((1u << taken) - 1)) << offset);
+
+                remaining >>= taken;
+                bits       -= taken;
+                m_Bit      += taken;
+            }
+        }
+
+        size_t bytes_written() const
+        {
+            return (m_Bit + 7) / 8;
+        }
+
+    private:
+        mbed::Span<uint8_t> m_Bytes;
+        size_t              m_Bit;
+    };
+
+    class TelemetryBitReader
+    {
+    public:
+        explicit TelemetryBitReader(mbed::Span<const uint8_t> bytes)
+            : m_Bytes(bytes)
+            , m_Bit(0)
+        {
+        }
+
+        /** Take the next bits as a signed value. The caller makes sure
+         *  there are that many left. */
+        int64_t read(unsigned bits)
+        {
+            uint64_t value = 0;
+            unsigned done  = 0;
+
+            while (done < bits)
+            {
+                const unsigned offset = m_Bit % 8;
+                const unsigned taken  = (bits - done < 8 - offset) ? bits - done : 8 - offset;
+
+                value |= static_cast<uint64_t>((m_Bytes[m_Bit / 8] >> offset) & ((1u << taken) - 1)) << done;
+
+                done  += taken;
+                m_Bit += taken;
+            }
+
+            // Sign extend.
+            const int64_t result = static_cast<int64_t>(value);
+            return (value >> (bits - 1)) ? result - (INT64_C(1) << bits) : result;
+        }
+
+    private:
+        mbed::Span<const uint8_t> m_Bytes;
+        size_t                    m_Bit;
+    };
+}
+
+template <size_t MaxChannels, size_t KeyframeInterval>
+class CompactTelemetryEncoder
+{
+    // The sample count and keyframe reference are 7 and 8 bits wide.
+    static_assert((KeyframeInterval >= 1) && (KeyframeInterval <= 127),
+                  "The keyframe interval must be between 1 and 127 samples");
+
+public:
+    static constexpr size_t HEADER_SIZE = detail::COMPACT_TELEMETRY_HEADER_SIZE;
+
+    CompactTelemetryEncoder()
+        : m_ChannelCount(0)
+        , m_SampleCount(0)
+        , m_Sequence(0xFFFF)
+        , m_Keyframes(0)
+    {
+    }
+
+    /** Append a channel. Channels are only added before the first sample. */
+    bool add_channel(const CompactTelemetryChannel_t &channel)
+    {
+        if ((m_ChannelCount == MaxChannels) || (m_SampleCount > 0) || !detail::is_valid_channel(channel))
+        {
+            return false;
+        }
+
+        m_Channels[m_ChannelCount++] = channel;
+        return true;
+    }
+
+    size_t channels() const
+    {
+        return m_ChannelCount;
+    }
+
+    const CompactTelemetryChannel_t & channel(size_t index) const
+    {
+        return m_Channels[index];
+    }
+
+    /** Add a sample, a value for every channel. Values beyond a channel's
+     *  value width saturate. */
+    void push(mbed::Span<const int32_t> values)
+    {
+        int32_t sample[MaxChannels];
+        bool    keyframe = (m_SampleCount == 0) || (m_SampleCount == KeyframeInterval);
+
+        for (size_t i = 0; i < m_ChannelCount; ++i)
+        {
+            const CompactTelemetryChannel_t &channel = m_Channels[i];
+
+            int64_t value = values[i];
+            value = (value < detail::min_signed(channel.m_ValueBits)) ? detail::min_signed(channel.m_ValueBits)
+                  : (value > detail::max_signed(channel.m_ValueBits)) ? detail::max_signed(channel.m_ValueBits)
+                  : value;
+
+            sample[i] = static_cast<int32_t>(value);
+
+            const int64_t delta = value - m_Samples[0][i];
+
+            if ((delta < detail::min_signed(channel.m_DeltaBits)) || (delta > detail::max_signed(channel.m_DeltaBits)))
+            {
+                keyframe = true;
+            }
+        }
+
+        if (keyframe)
+        {
+            m_SampleCount = 0;
+            ++m_Keyframes;
+        }
+
+        for (size_t i = 0; i < m_ChannelCount; ++i)
+        {
+            m_Samples[m_SampleCount][i] = sample[i];
+        }
+
+        ++m_SampleCount;
+        ++m_Sequence;
+    }
+
+    /** Write a frame of as many of the newest samples as fit in frame.
+     *  Returns its size, 0 when there is nothing to send or not even one
+     *  sample fits. */
+    size_t encode(mbed::Span<uint8_t> frame) const
+    {
+        if ((m_SampleCount == 0) || (frame.size() <= HEADER_SIZE))
+        {
+            return 0;
+        }
+
+        size_t keyframeBits = 0;
+        size_t deltaBits    = 0;
+
+        for (size_t i = 0; i < m_ChannelCount; ++i)
+        {
+            keyframeBits += m_Channels[i].m_ValueBits;
+            deltaBits    += m_Channels[i].m_DeltaBits;
+        }
+
+        const size_t availableBits = (frame.size() - HEADER_SIZE) * 8;
+
+        // Start from the keyframe when the whole run since fits, which
+        // makes the frame self-contained, else send the newest deltas.
+        const bool withKeyframe = (keyframeBits + (m_SampleCount - 1) * deltaBits <= availableBits);
+
+        size_t first = 0;
+        size_t count = m_SampleCount;
+
+        if (!withKeyframe)
+        {
+            const size_t fitting = (deltaBits > 0) ? availableBits / deltaBits : 0;
+
+            count = (m_SampleCount - 1 < fitting) ? m_SampleCount - 1 : fitting;
+            first = m_SampleCount - count;
+
+            if (count == 0)
+            {
+                return 0;
+            }
+        }
+
+        const uint16_t keyframeSequence = static_cast<uint16_t>(m_Sequence - (m_SampleCount - 1));
+
+        frame[0] = static_cast<uint8_t>((withKeyframe ? detail::COMPACT_TELEMETRY_KEYFRAME : 0) | count);
+        frame[1] = static_cast<uint8_t>(m_Sequence);
+        frame[2] = static_cast<uint8_t>(m_Sequence >> 8);
+        frame[3] = static_cast<uint8_t>(keyframeSequence);
+
+        detail::TelemetryBitWriter writer(frame.subspan(HEADER_SIZE));
+
+        if (withKeyframe)
+        {
+            for (size_t i = 0; i < m_ChannelCount; ++i)
+            {
+                writer.write(m_Samples[0][i], m_Channels[i].m_ValueBits);
+            }
+
+            first = 1;
+        }
+
+        for (size_t sample = first; sample < m_SampleCount; ++sample)
+        {
+            for (size_t i = 0; i < m_ChannelCount; ++i)
+            {
+                writer.write(static_cast<int64_t>(m_Samples[sample][i]) - m_Samples[0][i], m_Channels[i].m_DeltaBits);
+            }
+        }
+
+        return HEADER_SIZE + writer.bytes_written();
+    }
+
+    /** Sequence number of the newest sample. */
+    uint16_t sequence() const
+    {
+        return m_Sequence;
+    }
+
+    uint32_t keyframes() const
+    {
+        return m_Keyframes;
+    }
+
+private:
+    CompactTelemetryChannel_t m_Channels[MaxChannels] = {};
+    size_t                    m_ChannelCount;
+
+    // The samples since the latest keyframe, which is the first of them.
+    int32_t                   m_Samples[KeyframeInterval][MaxChannels] = {};
+    size_t                    m_SampleCount;
+    uint16_t                  m_Sequence;
+    uint32_t                  m_Keyframes;
+};
+
+/** Reference decoder, for gateways: turns the frames received from one
+ *  device back into its stream of samples. Frames may be lost, repeated
+ *  or overlap, every sample is passed on once and in order. A gap in the
+ *  sequence numbers passed on shows samples that never made it. */
+template <size_t MaxChannels>
+class CompactTelemetryDecoder
+{
+public:
+    static constexpr size_t HEADER_SIZE = detail::COMPACT_TELEMETRY_HEADER_SIZE;
+
+    enum Result_t
+    {
+        DECODED,
+        MISSING_KEYFRAME,   // Deltas against a keyframe not received yet.
+        MALFORMED
+    };
+
+    CompactTelemetryDecoder()
+        : m_ChannelCount(0)
+        , m_HasKeyframe(false)
+        , m_KeyframeSequence(0)
+        , m_HasDelivered(false)
+        , m_LastDelivered(0)
+    {
+    }
+
+    /** Append a channel, the same as the encoder's, in the same order. */
+    bool add_channel(const CompactTelemetryChannel_t &channel)
+    {
+        if ((m_ChannelCount == MaxChannels) || !detail::is_valid_channel(channel))
+        {
+            return false;
+        }
+
+        m_Channels[m_ChannelCount++] = channel;
+        return true;
+    }
+
+    /** Decode frame, calling sink(uint16_t sequence, mbed::Span<const int32_t>
+     *  values) for every sample not passed on before. */
+    template <typename Sink>
+    Result_t decode(mbed::Span<const uint8_t> frame, Sink sink)
+    {
+        if (frame.size() < HEADER_SIZE)
+        {
+            return MALFORMED;
+        }
+
+        const bool     withKeyframe = (frame[0] & detail::COMPACT_TELEMETRY_KEYFRAME) != 0;
+        const size_t   count        = frame[0] & (detail::COMPACT_TELEMETRY_KEYFRAME - 1);
+        const uint16_t newest       = static_cast<uint16_t>(frame[1] | frame[2] << 8);
+        const uint16_t oldest       = static_cast<uint16_t>(newest - (count - 1));
+
+        // Keyframes are less than 128 samples back, the low 8 bits are enough.
+        const uint16_t keyframeSequence = static_cast<uint16_t>(newest - ((newest - frame[3]) & 0xFF));
+
+        if ((count == 0) || (withKeyframe && (oldest != keyframeSequence)))
+        {
+            return MALFORMED;
+        }
+
+        size_t keyframeBits = 0;
+        size_t deltaBits    = 0;
+
+        for (size_t i = 0; i < m_ChannelCount; ++i)
+        {
+            keyframeBits += m_Channels[i].m_ValueBits;
+            deltaBits    += m_Channels[i].m_DeltaBits;
+        }
+
+        const size_t bits = withKeyframe ? keyframeBits + (count - 1) * deltaBits : count * deltaBits;
+
+        if ((frame.size() - HEADER_SIZE) * 8 < bits)
+        {
+            return MALFORMED;
+        }
+
+        detail::TelemetryBitReader reader(frame.subspan(HEADER_SIZE));
+
+        if (withKeyframe)
+        {
+            for (size_t i = 0; i < m_ChannelCount; ++i)
+            {
+                m_Keyframe[i] = static_cast<int32_t>(reader.read(m_Channels[i].m_ValueBits));
+            }
+
+            m_HasKeyframe      = true;
+            m_KeyframeSequence = keyframeSequence;
+        }
+        else if (!m_HasKeyframe || (m_KeyframeSequence != keyframeSequence))
+        {
+            return MISSING_KEYFRAME;
+        }
+
+        for (size_t sample = 0; sample < count; ++sample)
+        {
+            const uint16_t sequence = static_cast<uint16_t>(oldest + sample);
+            int32_t        values[MaxChannels];
+
+            for (size_t i = 0; i < m_ChannelCount; ++i)
+            {
+                values[i] = (withKeyframe && (sample == 0))
+                            ? m_Keyframe[i]
+                            : static_cast<int32_t>(m_Keyframe[i] + reader.read(m_Channels[i].m_DeltaBits));
+            }
+
+            if (!m_HasDelivered || (static_cast<int16_t>(sequence - m_LastDelivered) > 0))
+            {
+                m_HasDelivered  = true;
+                m_LastDelivered = sequence;
+                sink(sequence, mbed::make_const_Span(values, m_ChannelCount));
+            }
+        }
+
+        return DECODED;
+    }
+
+private:
+    CompactTelemetryChannel_t m_Channels[MaxChannels] = {};
+    size_t                    m_ChannelCount;
+
+    int32_t                   m_Keyframe[MaxChannels] = {};
+    bool                      m_HasKeyframe;
+    uint16_t                  m_KeyframeSequence;
+    bool                      m_HasDelivered;
+    uint16_t                  m_LastDelivered;
+};
@@ -0,0 +1,100 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// Where between two connection events work is best done.
+//
+// While connected, the radio serves a connection event once every
+// connection interval, next to the advertising events of any set still
+// running. HCI traffic that arrives right before or during a connection
+// event competes with it. On a host that shares its transport with the
+// controller's interrupts (BlueNRG_MS over SPI, for one), work done then
+// delays the event, and a notification queued just too late misses it and
+// waits a whole interval. Payload updates and notification bursts
+// therefore go in the middle half of the interval, as far as possible from
+// the events on either side.
+//
+// Gap does not report connection events as such. Their timing is
+// inferred from onDataSent(), which the stack raises once a connection
+// event has carried a notification. It needs no more than one sample to
+// lock on, since every later event follows at a whole number of
+// intervals. Until that first notification, or when not connected, the
+// phase is unknown and work runs when asked.
+//
+// Times are in microseconds of the us_ticker and may wrap.
+class ConnectionEventScheduler
+{
+public:
+    ConnectionEventScheduler()
+        : m_IntervalUs(0)
+        , m_AnchorUs(0)
+        , m_Anchored(false)
+    {
+    }
+
+    /** A connection came up with, or changed to, this interval. */
+    void set_interval_us(uint32_t intervalUs)
+    {
+        m_IntervalUs = intervalUs;
+    }
+
+    /** A connection event took place at about nowUs. */
+    void on_connection_event(uint32_t nowUs)
+    {
+        m_AnchorUs = nowUs;
+        m_Anchored = true;
+    }
+
+    void on_disconnected()
+    {
+        m_IntervalUs = 0;
+        m_Anchored   = false;
+    }
+
+    /** Time from nowUs to the middle half of the current or next interval,
+     *  0 if nowUs is already within it, or if the phase is unknown. */
+    uint32_t delay_us(uint32_t nowUs) const
+    {
+        if (!m_Anchored || (m_IntervalUs == 0))
+        {
+            return 0;
+        }
+
+        const uint32_t phase       = (nowUs - m_AnchorUs) % m_IntervalUs;
+        const uint32_t windowStart = m_IntervalUs / 4;
+        const uint32_t windowEnd   = m_IntervalUs - windowStart;
+
+        if (phase < windowStart)
+        {
+            return windowStart - phase;
+        }
+
+        if (phase > windowEnd)
+        {
+            return m_IntervalUs - phase + windowStart;
+        }
+
+        return 0;
+    }
+
+private:
+    uint32_t m_IntervalUs;
+    uint32_t m_AnchorUs;
+    bool     m_Anchored;
+};
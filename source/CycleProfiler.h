@@ -0,0 +1,200 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "cmsis.h"
+#include "hal/us_ticker_api.h"
+#include "DeferredLog.h"
+
+// Cycle-accurate timing of the BLE API calls on the payload path.
+//
+// How long setAdvertisingPayload() and friends take differs a lot between
+// stacks and controllers. For example, BlueNRG_MS sits behind SPI, while
+// the WB55 routes HCI through IPCC to the radio core. PROFILED_CALL()
+// wraps a call and records its duration, in cycles of the DWT cycle
+// counter on Cortex-M3 and above. Where there is no DWT (or off target)
+// the microsecond ticker stands in. For each profile point the minimum,
+// maximum and mean are kept, along with a histogram with one bucket per
+// power of two.
+//
+// Without app.cycle-profiling the macro expands to the bare call, so
+// nothing is left behind in the image. Measurements are not thread safe
+// and are expected to come from the one thread driving the stack.
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+#define CYCLE_PROFILER_USES_DWT 1
+#else
+#define CYCLE_PROFILER_USES_DWT 0
+#endif
+
+class CycleProfiler
+{
+public:
+    enum Point_t
+    {
+        SET_ADVERTISING_PARAMETERS,
+        SET_ADVERTISING_PAYLOAD,
+        SET_ADVERTISING_SCAN_RESPONSE,
+        SET_PERIODIC_ADVERTISING_PAYLOAD,
+        SET_SERVICE_DATA,
+        START_ADVERTISING,
+        POINT_COUNT
+    };
+
+    // Bucket n counts durations in [2^n, 2^(n+1)), the last one everything above.
+    static constexpr size_t HISTOGRAM_BUCKETS = 24;
+
+    static CycleProfiler & instance()
+    {
+        static CycleProfiler profiler;
+        return profiler;
+    }
+
+    /** Start the cycle counter. Call once before the first measurement. */
+    void enable()
+    {
+#if CYCLE_PROFILER_USES_DWT
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT       = 0;
+        DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    }
+
+    void reset()
+    {
+        for (Statistics_t &statistics : m_Statistics)
+        {
+            statistics = Statistics_t();
+        }
+    }
+
+    template <typename F>
+    auto measure(Point_t point, F f) -> decltype(f())
+    {
+        const uint32_t start = now();
+        auto result = f();
+        record(point, now() - start);
+        return result;
+    }
+
+    /** Print the statistics through LOG_PRINTF(): a header, two lines per
+     *  point measured and one per histogram bucket in use. */
+    void print_report() const
+    {
+        LOG_PRINTF("Profile of BLE API calls, in %s:\r\n", CYCLE_PROFILER_USES_DWT ? "cycles" : "microseconds");
+
+        for (size_t point = 0; point < POINT_COUNT; ++point)
+        {
+            const Statistics_t &statistics = m_Statistics[point];
+
+            if (statistics.m_Count == 0)
+            {
+                continue;
+            }
+
+            LOG_PRINTF("  %-32s n %lu mean %lu\r\n",
+                       point_name(point),
+                       static_cast<unsigned long>(statistics.m_Count),
+                       static_cast<unsigned long>(statistics.m_Total / statistics.m_Count));
+            LOG_PRINTF("    min %lu max %lu\r\n",
+                       static_cast<unsigned long>(statistics.m_Minimum),
+                       static_cast<unsigned long>(statistics.m_Maximum));
+
+            for (size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket)
+            {
+                if (statistics.m_Histogram[bucket] != 0)
+                {
+                    LOG_PRINTF("    >= %-10lu %lu\r\n",
+                               1UL << bucket,
+                               static_cast<unsigned long>(statistics.m_Histogram[bucket]));
+                }
+            }
+        }
+    }
+
+private:
+    struct Statistics_t
+    {
+        uint32_t m_Count     = 0;
+        uint32_t m_Minimum   = UINT32_MAX;
+        uint32_t m_Maximum   = 0;
+        uint64_t m_Total     = 0;
+        uint32_t m_Histogram[HISTOGRAM_BUCKETS] = {};
+    };
+
+    static const char * point_name(size_t point)
+    {
+        static constexpr const char * names[POINT_COUNT] =
+        {
+            "setAdvertisingParameters",
+            "setAdvertisingPayload",
+            "setAdvertisingScanResponse",
+            "setPeriodicAdvertisingPayload",
+            "setServiceData",
+            "startAdvertising"
+        };
+
+        return names[point];
+    }
+
+    CycleProfiler() = default;
+
+    static uint32_t now()
+    {
+#if CYCLE_PROFILER_USES_DWT
+        return DWT->CYCCNT;
+#else
+        return us_ticker_read();
+#endif
+    }
+
+    void record(Point_t point, uint32_t duration)
+    {
+        Statistics_t &statistics = m_Statistics[point];
+
+        ++statistics.m_Count;
+        statistics.m_Total += duration;
+
+        if (duration < statistics.m_Minimum)
+        {
+            statistics.m_Minimum = duration;
+        }
+
+        if (duration > statistics.m_Maximum)
+        {
+            statistics.m_Maximum = duration;
+        }
+
+        // floor(log2(duration)), with 0 and 1 sharing the first bucket.
+        size_t bucket = (duration > 1) ? (31 - __CLZ(duration)) : 0;
+        if (bucket >= HISTOGRAM_BUCKETS)
+        {
+            bucket = HISTOGRAM_BUCKETS - 1;
+        }
+
+        ++statistics.m_Histogram[bucket];
+    }
+
+    Statistics_t m_Statistics[POINT_COUNT];
+};
+
+#if MBED_CONF_APP_CYCLE_PROFILING
+#define PROFILED_CALL(point, call) \
+    CycleProfiler::instance().measure(CycleProfiler::point, [&]() { return call; })
+#else
+#define PROFILED_CALL(point, call) (call)
+#endif
@@ -0,0 +1,187 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include "platform/mbed_assert.h"
+#include "platform/mbed_critical.h"
+#include "platform/mbed_atomic.h"
+#include "platform/mbed_toolchain.h"
+#include "rtos/Thread.h"
+#include "rtos/Semaphore.h"
+
+// Logging that never makes the caller wait for the UART.
+//
+// At 9600 baud a single error line keeps printf() busy for tens of
+// milliseconds, and while it does nothing else on that event queue runs,
+// including BLE::processEvents. record() instead stores the format string
+// pointer and the raw argument values in a ring buffer, which takes a few
+// stores inside a short critical section. A low priority thread then
+// formats and prints the entries whenever nothing more important wants
+// the CPU.
+//
+// Formats must be string literals and %s arguments must point to strings
+// with static storage duration (such as those ToString() returns), since
+// only the pointers are kept until the entry is printed. When the ring is
+// full the newest entries are dropped and counted, never the caller
+// blocked.
+class DeferredLog
+{
+public:
+    static constexpr size_t MAX_ARGUMENTS = 4;
+
+    static DeferredLog & instance()
+    {
+        static DeferredLog log;
+        return log;
+    }
+
+    /** Start the thread that prints the recorded entries. */
+    void start()
+    {
+        m_Thread.start(mbed::callback(this, &DeferredLog::drain_forever));
+    }
+
+    template <typename... Args>
+    void record(const char *format, Args... args)
+    {
+        static_assert(sizeof...(Args) <= MAX_ARGUMENTS, "Too many arguments for a deferred log entry");
+
+        const uintptr_t arguments[sizeof...(Args) + 1] = { to_slot(args)..., 0 };
+
+        core_util_critical_section_enter();
+
+        const bool full = (m_Count == MBED_CONF_APP_DEFERRED_LOG_ENTRIES);
+
+        if (!full)
+        {
+            Entry_t &entry = m_Entries[(m_Head + m_Count) % MBED_CONF_APP_DEFERRED_LOG_ENTRIES];
+
+            entry.m_Format  = format;
+            entry.m_Printer = &print_entry<Args...>;
+            memcpy(entry.m_Arguments, arguments, sizeof...(Args) * sizeof(uintptr_t));
+
+            ++m_Count;
+        }
+
+        core_util_critical_section_exit();
+
+        if (full)
+        {
+            core_util_atomic_incr_u32(&m_Dropped, 1);
+        }
+        else
+        {
+            m_Pending.release();
+        }
+    }
+
+private:
+    struct Entry_t
+    {
+        const char * m_Format;
+        void (*m_Printer)(const Entry_t &);
+        uintptr_t    m_Arguments[MAX_ARGUMENTS];
+    };
+
+    DeferredLog()
+        : m_Head(0)
+        , m_Count(0)
+        , m_Dropped(0)
+        , m_Pending(0)
+        , m_Thread(osPriorityLow, sizeof(m_ThreadStack), m_ThreadStack, "deferred_log")
+    {
+    }
+
+    template <typename T>
+    static uintptr_t to_slot(T value)
+    {
+        static_assert((std::is_arithmetic<T>::value || std::is_pointer<T>::value || std::is_enum<T>::value)
+                      && (sizeof(T) <= sizeof(uintptr_t)),
+                      "Deferred log arguments must be scalars no wider than a pointer");
+
+        uintptr_t slot = 0;
+        memcpy(&slot, &value, sizeof(T));
+        return slot;
+    }
+
+    template <typename T>
+    static T from_slot(uintptr_t slot)
+    {
+        T value;
+        memcpy(&value, &slot, sizeof(T));
+        return value;
+    }
+
+    template <typename... Args, size_t... Index>
+    static void print_unpacked(const Entry_t &entry, std::index_sequence<Index...>)
+    {
+        printf(entry.m_Format, from_slot<Args>(entry.m_Arguments[Index])...);
+    }
+
+    template <typename... Args>
+    static void print_entry(const Entry_t &entry)
+    {
+        print_unpacked<Args...>(entry, std::index_sequence_for<Args...>());
+    }
+
+    void drain_forever()
+    {
+        while (true)
+        {
+            m_Pending.acquire();
+
+            // Copy the entry out so that printing happens outside the
+            // critical section and producers are never held up by it.
+            core_util_critical_section_enter();
+            const Entry_t entry = m_Entries[m_Head];
+            m_Head = (m_Head + 1) % MBED_CONF_APP_DEFERRED_LOG_ENTRIES;
+            --m_Count;
+            core_util_critical_section_exit();
+
+            entry.m_Printer(entry);
+
+            const uint32_t dropped = core_util_atomic_exchange_u32(&m_Dropped, 0);
+
+            if (dropped)
+            {
+                printf("Warning! %lu deferred log entries dropped\r\n", static_cast<unsigned long>(dropped));
+            }
+        }
+    }
+
+    Entry_t          m_Entries[MBED_CONF_APP_DEFERRED_LOG_ENTRIES];
+    size_t           m_Head;
+    size_t           m_Count;
+    uint32_t         m_Dropped;
+    rtos::Semaphore  m_Pending;
+
+    MBED_ALIGN(8) unsigned char m_ThreadStack[MBED_CONF_APP_DEFERRED_LOG_THREAD_STACK_SIZE];
+    rtos::Thread     m_Thread;
+};
+
+// Error paths and banners print through LOG_PRINTF(). With
+// app.deferred-log it records into DeferredLog, otherwise it is printf().
+#if MBED_CONF_APP_DEFERRED_LOG
+#define LOG_PRINTF(...) DeferredLog::instance().record(__VA_ARGS__)
+#else
+#define LOG_PRINTF(...) printf(__VA_ARGS__)
+#endif
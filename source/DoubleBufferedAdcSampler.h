@@ -0,0 +1,104 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "LatestValueSlot.h"
+
+// The sampling stage of an ADC that converts continuously into memory by
+// DMA, entirely apart from the BLE event queue.
+//
+// The DMA runs in circular mode over a buffer of two blocks. It raises an
+// interrupt when it is half way, i.e. the first block is full, and again
+// at the end, and carries on into the other block meanwhile. Each
+// interrupt reduces the block just filled to its mean, smooths the means
+// with an exponential filter and publishes the result through a
+// LatestValueSlot. The payload stage reads the slot whenever it likes,
+// which never waits on the ADC, the DMA or the interrupt.
+//
+// A block has to be reduced before the DMA comes back round to it, one
+// block's conversion time later; summing a few dozen samples takes a
+// tiny fraction of that.
+template <size_t BlockSize, unsigned FilterShift>
+class DoubleBufferedAdcSampler
+{
+    static_assert(BlockSize > 0, "A DMA block needs at least one sample");
+    static_assert(BlockSize <= 256, "A block of 16-bit samples, with the 8 fractional bits, must sum within 32 bits");
+    static_assert(FilterShift < 16, "The filter shift is at most 15");
+
+public:
+    DoubleBufferedAdcSampler()
+        : m_Filtered(0)
+        , m_Blocks(0)
+    {
+    }
+
+    /** The buffer to point the DMA at, two blocks of samples. */
+    uint16_t * dma_buffer()
+    {
+        return m_Buffer;
+    }
+
+    static constexpr size_t dma_length()
+    {
+        return 2 * BlockSize;
+    }
+
+    /** Interrupt side: the DMA is half way, the first block is full. */
+    void on_half_transfer()
+    {
+        reduce(&m_Buffer[0]);
+    }
+
+    /** Interrupt side: the DMA wrapped round, the second block is full. */
+    void on_transfer_complete()
+    {
+        reduce(&m_Buffer[BlockSize]);
+    }
+
+    /** Payload side: the latest filtered sample, false until the first
+     *  block is in. */
+    bool latest(uint16_t &sample)
+    {
+        return m_Slot.latest(sample);
+    }
+
+private:
+    void reduce(const uint16_t *block)
+    {
+        uint32_t sum = 0;
+
+        for (size_t i = 0; i < BlockSize; ++i)
+        {
+            sum += block[i];
+        }
+
+        // The filter state keeps 8 fractional bits, so that small steps
+        // are not lost to the shift.
+        const int32_t mean = static_cast<int32_t>((sum << 8) / BlockSize);
+
+        m_Filtered = (m_Blocks++ == 0) ? mean : m_Filtered + ((mean - m_Filtered) >> FilterShift);
+
+        m_Slot.publish(static_cast<uint16_t>((m_Filtered + 0x80) >> 8));
+    }
+
+    uint16_t                  m_Buffer[2 * BlockSize] = {};
+    int32_t                   m_Filtered;
+    uint32_t                  m_Blocks;
+    LatestValueSlot<uint16_t> m_Slot;
+};
@@ -0,0 +1,181 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "ble/common/blecommon.h"
+
+// The counters as they stand, as printed and as the diagnostics beacon
+// frame carries them, together with the queue depth. 0xFF stands for an
+// 8-bit value not known.
+struct DiagnosticsReading_t
+{
+    uint32_t m_PayloadCommits;
+    uint32_t m_StackBusy;
+    uint32_t m_NoMemory;
+    uint32_t m_OtherFailures;
+    uint32_t m_AdvertisingEvents;
+    uint32_t m_ScanRequests;
+    uint8_t  m_EventsPending;
+    uint8_t  m_EventsPendingPeak;
+    uint8_t  m_CpuIdlePercent;
+};
+
+// Counters of what the radio and the stack did since start up, for sizing
+// a fleet from measurements:
+//
+// - advertising payload writes the controller took, and those it refused,
+//   per ble_error_t. Codes past the end of the error table, ErrorCodes
+//   long, share the last count.
+// - advertising events. The controller does not report them, so they are
+//   estimated from the time each run of the set lasted and its interval.
+//   Every event is delayed by a random 0 to 10 ms on top of the interval,
+//   hence 5 ms are added to it.
+// - scan requests the controller reported.
+// - the share of the CPU time spent idle over the latest window, from the
+//   uptime and idle time of the CPU statistics.
+//
+// Everything is updated on the queue that runs the BLE events, so plain
+// counters do.
+template <size_t ErrorCodes>
+class HealthCounters
+{
+public:
+    static constexpr uint8_t UNKNOWN_PERCENT = 0xFF;
+
+    HealthCounters()
+        : m_PayloadCommits(0)
+        , m_AdvertisingEvents(0)
+        , m_AdvertisingSinceMs(0)
+        , m_AdvertisingIntervalMs(0)
+        , m_Advertising(false)
+        , m_ScanRequests(0)
+        , m_CpuUptimeUs(0)
+        , m_CpuIdleUs(0)
+        , m_CpuIdlePercent(UNKNOWN_PERCENT)
+    {
+    }
+
+    void on_payload_committed()
+    {
+        ++m_PayloadCommits;
+    }
+
+    void on_payload_commit_failed(ble_error_t error)
+    {
+        const size_t code = static_cast<size_t>(error);
+
+        ++m_CommitFailures[(code < ErrorCodes) ? code : ErrorCodes];
+    }
+
+    uint32_t payload_commits() const
+    {
+        return m_PayloadCommits;
+    }
+
+    /** Failed writes with code, ErrorCodes for any code not in the table. */
+    uint32_t commit_failures(size_t code) const
+    {
+        return m_CommitFailures[(code < ErrorCodes) ? code : ErrorCodes];
+    }
+
+    uint32_t commit_failures() const
+    {
+        uint32_t total = 0;
+
+        for (size_t code = 0; code <= ErrorCodes; ++code)
+        {
+            total += m_CommitFailures[code];
+        }
+
+        return total;
+    }
+
+    void on_advertising_started(uint64_t nowMs, uint32_t intervalMs)
+    {
+        on_advertising_ended(nowMs);
+
+        m_Advertising           = true;
+        m_AdvertisingSinceMs    = nowMs;
+        m_AdvertisingIntervalMs = intervalMs;
+    }
+
+    void on_advertising_ended(uint64_t nowMs)
+    {
+        m_AdvertisingEvents = advertising_events(nowMs);
+        m_Advertising       = false;
+    }
+
+    uint32_t advertising_events(uint64_t nowMs) const
+    {
+        if (!m_Advertising)
+        {
+            return m_AdvertisingEvents;
+        }
+
+        // The first event goes out as soon as the set is enabled.
+        return m_AdvertisingEvents + 1
+               + static_cast<uint32_t>((nowMs - m_AdvertisingSinceMs) / (m_AdvertisingIntervalMs + 5));
+    }
+
+    void on_scan_request()
+    {
+        ++m_ScanRequests;
+    }
+
+    uint32_t scan_requests() const
+    {
+        return m_ScanRequests;
+    }
+
+    /** Close the CPU window at the given statistics and start the next. */
+    void on_cpu_sample(uint64_t uptimeUs, uint64_t idleUs)
+    {
+        const uint64_t uptime = uptimeUs - m_CpuUptimeUs;
+        const uint64_t idle   = idleUs - m_CpuIdleUs;
+
+        if (uptime > 0)
+        {
+            m_CpuIdlePercent = static_cast<uint8_t>(((idle < uptime) ? idle : uptime) * 100 / uptime);
+        }
+
+        m_CpuUptimeUs = uptimeUs;
+        m_CpuIdleUs   = idleUs;
+    }
+
+    /** Idle share of the last window, UNKNOWN_PERCENT before the first. */
+    uint8_t cpu_idle_percent() const
+    {
+        return m_CpuIdlePercent;
+    }
+
+private:
+    uint32_t m_PayloadCommits;
+    uint32_t m_CommitFailures[ErrorCodes + 1] = {};
+
+    uint32_t m_AdvertisingEvents;     // Up to the current run of the set.
+    uint64_t m_AdvertisingSinceMs;
+    uint32_t m_AdvertisingIntervalMs;
+    bool     m_Advertising;
+
+    uint32_t m_ScanRequests;
+
+    uint64_t m_CpuUptimeUs;
+    uint64_t m_CpuIdleUs;
+    uint8_t  m_CpuIdlePercent;
+};
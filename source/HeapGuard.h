@@ -0,0 +1,112 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "platform/mbed_assert.h"
+#include "platform/mbed_stats.h"
+#include "DeferredLog.h"
+
+// A check that nothing allocates from the heap once start up is over.
+//
+// A device meant to run for months cannot afford a heap that slowly
+// fragments, so with app.zero-heap-after-init every allocation in the
+// steady state is a bug. The advertising loop itself keeps its state in
+// the encapsulation and its events in the event queues, all statically
+// allocated, but a library call may still allocate behind its back.
+//
+// mbed's heap statistics come from its wrappers of _malloc_r and friends
+// (the --wrap flags in my_profile.json), which count every allocation
+// made through them. HeapGuard takes a snapshot of the count once start
+// up is over, and check() compares against it. total_size only ever
+// grows, so an allocation is caught even when it was freed again before
+// the check. A failed allocation is caught too.
+//
+// A trip is logged along with where it was noticed, which is after the
+// fact: what allocated ran since the previous check. It then asserts, so
+// that a debug build stops right there. A release build carries on, and
+// reports each further trip once.
+class HeapGuard
+{
+public:
+    /** Start up is over, from now on nothing may allocate. */
+    static void arm()
+    {
+        State_t &state = state_of_guard();
+
+        take(state.m_Snapshot);
+        state.m_Armed = true;
+    }
+
+    /** Check that nothing allocated since arm() or the previous trip;
+     *  where says what just ran. */
+    static void check(const char *where)
+    {
+        State_t &state = state_of_guard();
+
+        if (!state.m_Armed)
+        {
+            return;
+        }
+
+        Snapshot_t current;
+        take(current);
+
+        if ((current.m_TotalSize == state.m_Snapshot.m_TotalSize)
+            && (current.m_FailedAllocations == state.m_Snapshot.m_FailedAllocations))
+        {
+            return;
+        }
+
+        LOG_PRINTF("Error! %lu heap bytes allocated after init, %lu allocations failed, by %s\r\n",
+                   static_cast<unsigned long>(current.m_TotalSize - state.m_Snapshot.m_TotalSize),
+                   static_cast<unsigned long>(current.m_FailedAllocations - state.m_Snapshot.m_FailedAllocations),
+                   where);
+
+        state.m_Snapshot = current;
+
+        MBED_ASSERT(!"heap allocation after init");
+    }
+
+private:
+    struct Snapshot_t
+    {
+        uint32_t m_TotalSize;
+        uint32_t m_FailedAllocations;
+    };
+
+    struct State_t
+    {
+        Snapshot_t m_Snapshot;
+        bool       m_Armed;
+    };
+
+    static void take(Snapshot_t &snapshot)
+    {
+        mbed_stats_heap_t heap;
+        mbed_stats_heap_get(&heap);
+
+        snapshot.m_TotalSize         = heap.total_size;
+        snapshot.m_FailedAllocations = heap.alloc_fail_cnt;
+    }
+
+    static State_t & state_of_guard()
+    {
+        static State_t state = {};
+        return state;
+    }
+};
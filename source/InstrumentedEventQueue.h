@@ -0,0 +1,367 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstring>
+#include <chrono>
+#include <events/mbed_events.h>
+#include "platform/mbed_atomic.h"
+#include "hal/us_ticker_api.h"
+#include "DeferredLog.h"
+
+// An EventQueue that keeps count of what goes through it.
+//
+// The queue's buffer is a fixed size, and once it runs out call() and
+// friends simply return 0. Callers rarely check that. These counters make
+// such failures visible, together with the peak number of events held at
+// any one time, so that the buffer can be sized from measurements rather
+// than guesses:
+//
+// - every call()/call_in() event is pending from the moment it is posted
+//   until it starts running, while a call_every() event stays pending
+//   until it is cancelled, since it keeps its allocation for that long.
+// - dispatch latency is how late a callback started compared to when it
+//   was due, i.e. how long it sat behind other work in the queue.
+//
+// Every event is posted under the name of its call site, a string with
+// static storage duration, and the dispatch statistics are kept per name
+// as well, for the first MAX_SITES names; any past those share one entry.
+// The names are only looked up on the dispatching thread, so posting
+// stays a handful of atomic increments.
+//
+// The wrappers capture the queue, the name and the timing state along
+// with the callable, so every event is EVENT_OVERHEAD bytes larger than
+// with a plain EventQueue, and buffers sized in EVENTS_EVENT_SIZE need to
+// grow by that much per event.
+//
+// Events can be posted from any thread or interrupt, so the posting side
+// counters are updated atomically. Dispatch side statistics are only ever
+// touched by the thread dispatching the queue.
+//
+// Only the call(), call_in(), call_every() and cancel() forms used by this
+// application are wrapped, with the site name first. They hide, rather
+// than override, the ones in events::EventQueue, so the queue must be used
+// through this type. PlainEventQueue takes the same calls without any of
+// the instrumentation.
+class InstrumentedEventQueue : public events::EventQueue
+{
+public:
+    struct Statistics_t
+    {
+        uint32_t m_Posted;
+        uint32_t m_CallFailures;        // call() and call_in() that returned 0.
+        uint32_t m_CallEveryFailures;   // call_every() that returned 0.
+        uint32_t m_Pending;
+        uint32_t m_PendingHighWaterMark;
+        uint32_t m_Dispatched;
+        uint32_t m_MaxDispatchLatencyUs;
+        uint64_t m_TotalDispatchLatencyUs;
+        uint32_t m_MaxExecutionUs;
+    };
+
+    struct SiteStatistics_t
+    {
+        const char * m_Name;            // nullptr for the names past MAX_SITES.
+        uint32_t     m_Dispatched;
+        uint32_t     m_MaxDispatchLatencyUs;
+        uint32_t     m_MaxExecutionUs;
+    };
+
+    static constexpr size_t MAX_SITES = MBED_CONF_APP_EVENT_QUEUE_MAX_SITES;
+
+    // The queue, the site name, when the event is due and its period.
+    static constexpr size_t EVENT_OVERHEAD = 2 * sizeof(void *) + 2 * sizeof(uint32_t);
+
+    explicit InstrumentedEventQueue(size_t size = EVENTS_QUEUE_SIZE, unsigned char *buffer = nullptr)
+        : events::EventQueue(size, buffer)
+        , m_Statistics()
+        , m_Sites()
+        , m_SiteCount(0)
+    {
+    }
+
+    template <typename F>
+    int call(const char *site, F f)
+    {
+        return post_once(site, std::chrono::milliseconds(0), f);
+    }
+
+    template <typename T, typename R>
+    int call(const char *site, T *object, R (T::*method)())
+    {
+        return call(site, mbed::callback(object, method));
+    }
+
+    template <typename Duration, typename F>
+    int call_in(const char *site, Duration delay, F f)
+    {
+        return post_once(site, std::chrono::duration_cast<std::chrono::milliseconds>(delay), f);
+    }
+
+    template <typename Duration, typename F>
+    int call_every(const char *site, Duration period, F f)
+    {
+        const uint32_t periodUs = to_microseconds(period);
+        uint32_t       due      = us_ticker_read() + periodUs;
+
+        note_posted();
+
+        const int id = events::EventQueue::call_every(period, [this, f, site, due, periodUs]() mutable
+                                                              {
+                                                                  dispatch(f, site, due, false);
+                                                                  due += periodUs;
+                                                              }
+        );
+
+        if (!id)
+        {
+            note_post_failed(&m_Statistics.m_CallEveryFailures);
+        }
+
+        return id;
+    }
+
+    /** Cancel event id. A call_every() event cancelled from its own
+     *  callback is freed all the same, but equeue reports false, so it
+     *  stays counted as pending; replace a periodic event from an event of
+     *  its own instead. */
+    bool cancel(int id)
+    {
+        const bool cancelled = events::EventQueue::cancel(id);
+
+        if (cancelled)
+        {
+            core_util_atomic_decr_u32(&m_Statistics.m_Pending, 1);
+        }
+
+        return cancelled;
+    }
+
+    /** Copy of the counters as they stand. */
+    Statistics_t statistics() const
+    {
+        return m_Statistics;
+    }
+
+    /** Number of site entries in use, including the shared one. */
+    size_t sites() const
+    {
+        return m_SiteCount + ((m_Sites[MAX_SITES].m_Dispatched > 0) ? 1 : 0);
+    }
+
+    /** Site entry index, below sites(). The shared one comes last. */
+    const SiteStatistics_t & site(size_t index) const
+    {
+        return m_Sites[(index < m_SiteCount) ? index : MAX_SITES];
+    }
+
+    /** Print the counters through LOG_PRINTF(), so name must have static
+     *  storage duration. Three lines, a deferred log entry taking four
+     *  arguments at most, then one per site. */
+    void print_statistics(const char *name) const
+    {
+        const Statistics_t stats = statistics();
+        const uint32_t meanLatencyUs = stats.m_Dispatched
+                                       ? static_cast<uint32_t>(stats.m_TotalDispatchLatencyUs / stats.m_Dispatched)
+                                       : 0;
+
+        LOG_PRINTF("EventQueue \"%s\": posted %lu, failed call %lu, failed call_every %lu\r\n",
+                   name,
+                   static_cast<unsigned long>(stats.m_Posted),
+                   static_cast<unsigned long>(stats.m_CallFailures),
+                   static_cast<unsigned long>(stats.m_CallEveryFailures));
+        LOG_PRINTF("EventQueue \"%s\": pending %lu (peak %lu), dispatched %lu\r\n",
+                   name,
+                   static_cast<unsigned long>(stats.m_Pending),
+                   static_cast<unsigned long>(stats.m_PendingHighWaterMark),
+                   static_cast<unsigned long>(stats.m_Dispatched));
+        LOG_PRINTF("EventQueue \"%s\": latency us mean %lu max %lu, longest callback %lu us\r\n",
+                   name,
+                   static_cast<unsigned long>(meanLatencyUs),
+                   static_cast<unsigned long>(stats.m_MaxDispatchLatencyUs),
+                   static_cast<unsigned long>(stats.m_MaxExecutionUs));
+
+        for (size_t index = 0; index < sites(); ++index)
+        {
+            const SiteStatistics_t &entry = site(index);
+
+            LOG_PRINTF("  %-20s dispatched %lu, latency max %lu us, longest %lu us\r\n",
+                       entry.m_Name ? entry.m_Name : "(other sites)",
+                       static_cast<unsigned long>(entry.m_Dispatched),
+                       static_cast<unsigned long>(entry.m_MaxDispatchLatencyUs),
+                       static_cast<unsigned long>(entry.m_MaxExecutionUs));
+        }
+    }
+
+private:
+    template <typename Duration>
+    static uint32_t to_microseconds(Duration duration)
+    {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    }
+
+    template <typename F>
+    int post_once(const char *site, std::chrono::milliseconds delay, F f)
+    {
+        const uint32_t due = us_ticker_read() + to_microseconds(delay);
+
+        note_posted();
+
+        auto event = [this, f, site, due]() mutable
+                     {
+                         dispatch(f, site, due, true);
+                     };
+
+        const int id = (delay.count() == 0) ? events::EventQueue::call(event)
+                                            : events::EventQueue::call_in(delay, event);
+
+        if (!id)
+        {
+            note_post_failed(&m_Statistics.m_CallFailures);
+        }
+
+        return id;
+    }
+
+    void note_posted()
+    {
+        core_util_atomic_incr_u32(&m_Statistics.m_Posted, 1);
+
+        const uint32_t pending = core_util_atomic_incr_u32(&m_Statistics.m_Pending, 1);
+        uint32_t       peak    = core_util_atomic_load_u32(&m_Statistics.m_PendingHighWaterMark);
+
+        while ((pending > peak)
+               && !core_util_atomic_cas_u32(&m_Statistics.m_PendingHighWaterMark, &peak, pending))
+        {
+        }
+    }
+
+    void note_post_failed(uint32_t *counter)
+    {
+        core_util_atomic_incr_u32(counter, 1);
+        core_util_atomic_decr_u32(&m_Statistics.m_Pending, 1);
+    }
+
+    /** The entry of site, taking a free one if it has none yet. Dispatch
+     *  side only. */
+    SiteStatistics_t & site_statistics(const char *site)
+    {
+        for (size_t index = 0; index < m_SiteCount; ++index)
+        {
+            if ((m_Sites[index].m_Name == site) || !strcmp(m_Sites[index].m_Name, site))
+            {
+                return m_Sites[index];
+            }
+        }
+
+        if (m_SiteCount == MAX_SITES)
+        {
+            return m_Sites[MAX_SITES];
+        }
+
+        m_Sites[m_SiteCount].m_Name = site;
+        return m_Sites[m_SiteCount++];
+    }
+
+    template <typename F>
+    void dispatch(F &f, const char *site, uint32_t due, bool oneShot)
+    {
+        const uint32_t start = us_ticker_read();
+
+        // Serial arithmetic, a callback run ahead of time counts as on time.
+        const int32_t lateness = static_cast<int32_t>(start - due);
+        const uint32_t latency = (lateness > 0) ? static_cast<uint32_t>(lateness) : 0;
+
+        if (oneShot)
+        {
+            core_util_atomic_decr_u32(&m_Statistics.m_Pending, 1);
+        }
+
+        ++m_Statistics.m_Dispatched;
+        m_Statistics.m_TotalDispatchLatencyUs += latency;
+
+        if (latency > m_Statistics.m_MaxDispatchLatencyUs)
+        {
+            m_Statistics.m_MaxDispatchLatencyUs = latency;
+        }
+
+        SiteStatistics_t &entry = site_statistics(site);
+
+        ++entry.m_Dispatched;
+
+        if (latency > entry.m_MaxDispatchLatencyUs)
+        {
+            entry.m_MaxDispatchLatencyUs = latency;
+        }
+
+        f();
+
+        const uint32_t execution = us_ticker_read() - start;
+
+        if (execution > m_Statistics.m_MaxExecutionUs)
+        {
+            m_Statistics.m_MaxExecutionUs = execution;
+        }
+
+        if (execution > entry.m_MaxExecutionUs)
+        {
+            entry.m_MaxExecutionUs = execution;
+        }
+    }
+
+    Statistics_t     m_Statistics;
+
+    // One entry per site name, and the last for those past MAX_SITES.
+    SiteStatistics_t m_Sites[MAX_SITES + 1];
+    size_t           m_SiteCount;
+};
+
+// The queue without app.event-queue-instrumentation: the same calls as
+// InstrumentedEventQueue, straight to events::EventQueue with the site
+// names dropped, so that call sites read the same either way.
+class PlainEventQueue : public events::EventQueue
+{
+public:
+    explicit PlainEventQueue(size_t size = EVENTS_QUEUE_SIZE, unsigned char *buffer = nullptr)
+        : events::EventQueue(size, buffer)
+    {
+    }
+
+    template <typename F>
+    int call(const char *, F f)
+    {
+        return events::EventQueue::call(f);
+    }
+
+    template <typename T, typename R>
+    int call(const char *, T *object, R (T::*method)())
+    {
+        return events::EventQueue::call(object, method);
+    }
+
+    template <typename Duration, typename F>
+    int call_in(const char *, Duration delay, F f)
+    {
+        return events::EventQueue::call_in(delay, f);
+    }
+
+    template <typename Duration, typename F>
+    int call_every(const char *, Duration period, F f)
+    {
+        return events::EventQueue::call_every(period, f);
+    }
+};
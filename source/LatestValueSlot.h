@@ -0,0 +1,83 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "platform/mbed_atomic.h"
+
+// Hands the latest value from one producer, such as an interrupt handler,
+// to one consumer, such as an event queue callback, without either of
+// them ever waiting for the other.
+//
+// The slot is a triple buffer. The producer writes into a buffer only it
+// owns, then swaps it with the middle one in a single atomic exchange,
+// marking the middle as fresh. The consumer swaps its own buffer with the
+// middle one when that is fresh, and reads. No buffer is ever owned by
+// both sides at once, so there is no lock and no retry loop, and a
+// critical section is never needed. Values the consumer did not get to
+// before the next one came are overwritten, i.e. the consumer always gets
+// the newest value, which is what a sensor reading wants.
+template <typename T>
+class LatestValueSlot
+{
+public:
+    LatestValueSlot()
+        : m_Middle(1)
+        , m_Back(2)
+        , m_Front(0)
+        , m_HasValue(false)
+    {
+    }
+
+    /** Producer side: make value the latest. */
+    void publish(const T &value)
+    {
+        m_Values[m_Back] = value;
+        m_Back = core_util_atomic_exchange_u32(&m_Middle, m_Back | FRESH) & INDEX_MASK;
+    }
+
+    /** Consumer side: the latest value published, false until there is one. */
+    bool latest(T &value)
+    {
+        if (core_util_atomic_load_u32(&m_Middle) & FRESH)
+        {
+            m_Front    = core_util_atomic_exchange_u32(&m_Middle, m_Front) & INDEX_MASK;
+            m_HasValue = true;
+        }
+
+        if (!m_HasValue)
+        {
+            return false;
+        }
+
+        value = m_Values[m_Front];
+        return true;
+    }
+
+private:
+    static constexpr uint32_t INDEX_MASK = 0x3;
+    static constexpr uint32_t FRESH      = 0x4;
+
+    T                 m_Values[3] = {};
+
+    // The middle buffer's index and FRESH, shared by both sides; then the
+    // producer's and the consumer's own buffer.
+    volatile uint32_t m_Middle;
+    uint32_t          m_Back;
+    uint32_t          m_Front;
+    bool              m_HasValue;
+};
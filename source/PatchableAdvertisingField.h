@@ -0,0 +1,135 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstring>
+#include "platform/mbed_assert.h"
+#include "ble/BLE.h"
+
+// An advertising payload is a sequence of AD structures, each laid out as
+// [length][AD type][data...] where length counts the type byte plus the
+// data. Once the payload has been assembled by an AdvertisingDataBuilder,
+// the position of every value within the caller-owned buffer is fixed for
+// as long as the builder is not asked to add, remove or resize a field.
+//
+// PatchableAdvertisingField remembers where one such value lives so that
+// periodic updates become a plain store into the buffer instead of another
+// search-and-rewrite pass through the builder. Bind it again after any
+// builder mutation which could have moved the fields around.
+class PatchableAdvertisingField
+{
+public:
+    PatchableAdvertisingField()
+        : m_Offset(0)
+        , m_Length(0)
+    {
+    }
+
+    /** Locate the value of the first AD structure of the given type whose
+     *  data starts with prefix. The value is whatever follows the prefix. */
+    ble_error_t bind(mbed::Span<const uint8_t> payload,
+                     ble::adv_data_type_t type,
+                     mbed::Span<const uint8_t> prefix)
+    {
+        m_Offset = 0;
+        m_Length = 0;
+
+        size_t index = 0;
+        while (index + 1 < payload.size())
+        {
+            const size_t fieldLength = payload[index];
+
+            // A zero length marks the unused tail of a zero-filled buffer.
+            if (fieldLength == 0)
+            {
+                break;
+            }
+
+            if (index + 1 + fieldLength > payload.size())
+            {
+                return BLE_ERROR_INVALID_PARAM;
+            }
+
+            const size_t dataOffset = index + 2;
+            const size_t dataLength = fieldLength - 1;
+
+            if ((payload[index + 1] == type.value())
+                && (dataLength > prefix.size())
+                && (memcmp(&payload[dataOffset], prefix.data(), prefix.size()) == 0))
+            {
+                m_Offset = dataOffset + prefix.size();
+                m_Length = dataLength - prefix.size();
+                return BLE_ERROR_NONE;
+            }
+
+            index += 1 + fieldLength;
+        }
+
+        return BLE_ERROR_NOT_FOUND;
+    }
+
+    /** Locate the value of the 16-bit UUID service data AD structure. */
+    ble_error_t bind_service_data(mbed::Span<const uint8_t> payload, uint16_t uuid)
+    {
+        // Service UUIDs are transmitted in little-endian byte order.
+        const uint8_t uuidBytes[2] = { static_cast<uint8_t>(uuid & 0xFF),
+                                       static_cast<uint8_t>(uuid >> 8) };
+
+        return bind(payload, ble::adv_data_type_t::SERVICE_DATA_16BIT_ID, uuidBytes);
+    }
+
+    bool is_bound() const
+    {
+        return (m_Length != 0);
+    }
+
+    size_t offset() const
+    {
+        return m_Offset;
+    }
+
+    size_t length() const
+    {
+        return m_Length;
+    }
+
+    /** The bound value as a writable view into buffer. */
+    mbed::Span<uint8_t> slot(mbed::Span<uint8_t> buffer) const
+    {
+        MBED_ASSERT(is_bound() && (m_Offset + m_Length <= buffer.size()));
+        return buffer.subspan(m_Offset, m_Length);
+    }
+
+    /** Overwrite the first byte of the bound value in place. */
+    void patch(mbed::Span<uint8_t> buffer, uint8_t value) const
+    {
+        MBED_ASSERT(is_bound() && (m_Offset < buffer.size()));
+        buffer[m_Offset] = value;
+    }
+
+    /** Overwrite the bound value in place; value must not be longer than it. */
+    void patch(mbed::Span<uint8_t> buffer, mbed::Span<const uint8_t> value) const
+    {
+        MBED_ASSERT(is_bound() && (value.size() <= m_Length)
+                    && (m_Offset + m_Length <= buffer.size()));
+        memcpy(&buffer[m_Offset], value.data(), value.size());
+    }
+
+private:
+    size_t m_Offset;
+    size_t m_Length;
+};
@@ -0,0 +1,148 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "hal/trng_api.h"
+
+#if !DEVICE_TRNG
+#error "app.privacy with app.unit-name draws the unit IDs from a TRNG, which this target lacks"
+#endif
+
+// Unit IDs that change along with the resolvable private address.
+//
+// A private address is of no use if the payload names the unit anyway, so
+// with privacy the unit name digits are random and renewed along with the
+// address rather than taken from it. Drawing them is the slow part: the
+// TRNG takes a while to gather entropy, and the digits have to be hex
+// encoded. So the ID the next rotation switches to is drawn and encoded
+// well ahead, right after the previous rotation, and the rotation itself
+// only stores the ready digits into the payload and commits it. One
+// payload write means scanners see the old ID up to one advertising event
+// and the new one from the next, with no gap and no restart of the set.
+//
+// The rotation latency, from the deadline to the controller accepting the
+// new payload, is kept for the last rotation and as the worst so far. It
+// includes any wait for app.min-payload-commit-interval-ms or for a busy
+// stack.
+template <size_t Digits>
+class PrivateUnitIdRotation
+{
+public:
+    PrivateUnitIdRotation()
+        : m_Prepared(false)
+        , m_SwitchPending(false)
+        , m_SwitchStartUs(0)
+        , m_Rotations(0)
+        , m_LastLatencyUs(0)
+        , m_MaxLatencyUs(0)
+    {
+    }
+
+    /** Draw and encode the ID the next rotation switches to. Returns false
+     *  if the TRNG did not deliver, in which case the next rotation tries
+     *  again. */
+    bool prepare()
+    {
+        static constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+
+        uint8_t random[(Digits + 1) / 2];
+        size_t  length = 0;
+
+        trng_t trng;
+        trng_init(&trng);
+        const int result = trng_get_bytes(&trng, random, sizeof(random), &length);
+        trng_free(&trng);
+
+        m_Prepared = (result == 0) && (length == sizeof(random));
+
+        if (!m_Prepared)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < Digits; ++i)
+        {
+            const uint8_t byte = random[i / 2];
+            m_Next[i] = HEX_DIGITS[(i & 1) ? (byte & 0x0F) : (byte >> 4)];
+        }
+
+        return true;
+    }
+
+    bool is_prepared() const
+    {
+        return m_Prepared;
+    }
+
+    /** The digits prepare() encoded, not null terminated. */
+    const char * next_digits() const
+    {
+        return m_Next;
+    }
+
+    /** The payload now holds next_digits(), nowUs being the deadline. */
+    void on_switch_started(uint32_t nowUs)
+    {
+        m_Prepared      = false;
+        m_SwitchPending = true;
+        m_SwitchStartUs = nowUs;
+    }
+
+    bool is_switch_pending() const
+    {
+        return m_SwitchPending;
+    }
+
+    /** The controller took the payload with the new ID. */
+    void on_switch_committed(uint32_t nowUs)
+    {
+        m_SwitchPending = false;
+        m_LastLatencyUs = nowUs - m_SwitchStartUs;
+        ++m_Rotations;
+
+        if (m_LastLatencyUs > m_MaxLatencyUs)
+        {
+            m_MaxLatencyUs = m_LastLatencyUs;
+        }
+    }
+
+    uint32_t rotations() const
+    {
+        return m_Rotations;
+    }
+
+    uint32_t last_latency_us() const
+    {
+        return m_LastLatencyUs;
+    }
+
+    uint32_t max_latency_us() const
+    {
+        return m_MaxLatencyUs;
+    }
+
+private:
+    char     m_Next[Digits] = {};
+    bool     m_Prepared;
+    bool     m_SwitchPending;
+    uint32_t m_SwitchStartUs;
+    uint32_t m_Rotations;
+    uint32_t m_LastLatencyUs;
+    uint32_t m_MaxLatencyUs;
+};
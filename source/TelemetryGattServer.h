@@ -0,0 +1,304 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "ble/BLE.h"
+#include "ble/GattServer.h"
+#include "platform/Callback.h"
+#include "platform/Span.h"
+
+// GATT services offered while the device is connectable.
+//
+// - Battery Service (0x180F): the standard Battery Level characteristic,
+//   readable, and notified whenever the level changes.
+// - Telemetry: a vendor specific service whose single characteristic
+//   notifies batches of samples. A sample is the latest value of every
+//   advertised field, encoded back to back as in the advertising payload.
+//
+// Each telemetry notification is laid out as follows, all little-endian:
+//
+//   offset  size
+//   0       2     sequence number of the first sample, counting from the
+//                 connection, so that a gap in the sequence shows a loss
+//   2       1     number of samples
+//   3       1     bytes per sample
+//   4       n     the samples, oldest first
+//
+// An ATT notification carries at most ATT_MTU - 3 bytes. A batch therefore
+// holds as many samples as fit, up to app.telemetry-batch-samples, and
+// grows once the MTU exchange has finished. Every batch costs one
+// notification and its link layer overhead, however many samples it
+// holds, and that is where batching gets its throughput. A batch the stack
+// has no room for is retried on the next onDataSent(). Samples that arrive
+// while it is still held back are dropped and counted.
+class TelemetryGattServer : ble::GattServer::EventHandler
+{
+public:
+    // Default ATT_MTU, until the exchange with the client agrees on more.
+    static constexpr uint16_t DEFAULT_ATT_MTU = 23;
+
+    static constexpr size_t HEADER_SIZE = 4;
+
+    // Largest notification, i.e. the largest ATT_MTU the Cordio build is
+    // configured for (cordio.desired-att-mtu) less the 3 byte ATT header.
+    static constexpr size_t MAX_NOTIFICATION_SIZE = MBED_CONF_APP_TELEMETRY_MAX_NOTIFICATION_SIZE;
+
+    static_assert(MAX_NOTIFICATION_SIZE > HEADER_SIZE, "app.telemetry-max-notification-size leaves no room for samples");
+
+    TelemetryGattServer()
+        : m_Server(nullptr)
+        , m_BatteryLevel(0)
+        , m_Batch()
+        , m_BatteryLevelCharacteristic(GattCharacteristic::UUID_BATTERY_LEVEL_CHAR,
+                                       &m_BatteryLevel, sizeof(m_BatteryLevel), sizeof(m_BatteryLevel),
+                                       GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ
+                                       | GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY,
+                                       nullptr, 0, false)
+        , m_TelemetryCharacteristic(UUID(TELEMETRY_CHARACTERISTIC_UUID),
+                                    m_Batch, 0, sizeof(m_Batch),
+                                    GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY,
+                                    nullptr, 0, true)
+        , m_SampleSize(0)
+        , m_AttMtu(DEFAULT_ATT_MTU)
+        , m_Subscribed(false)
+        , m_FlushPending(false)
+        , m_Sequence(0)
+        , m_SampleCount(0)
+        , m_DroppedSamples(0)
+        , m_Notifications(0)
+    {
+    }
+
+    /** Register both services with the server of ble, for samples of
+     *  sampleSize bytes. */
+    ble_error_t start(BLE &ble, size_t sampleSize)
+    {
+        m_Server     = &ble.gattServer();
+        m_SampleSize = sampleSize;
+
+        GattCharacteristic *batteryCharacteristics[]   = { &m_BatteryLevelCharacteristic };
+        GattCharacteristic *telemetryCharacteristics[] = { &m_TelemetryCharacteristic };
+
+        GattService batteryService(GattService::UUID_BATTERY_SERVICE, batteryCharacteristics, 1);
+        GattService telemetryService(UUID(TELEMETRY_SERVICE_UUID), telemetryCharacteristics, 1);
+
+        ble_error_t error = m_Server->addService(batteryService);
+
+        if (!error)
+        {
+            error = m_Server->addService(telemetryService);
+        }
+
+        if (!error)
+        {
+            m_Server->setEventHandler(this);
+        }
+
+        return error;
+    }
+
+    /** A client connected: start counting samples afresh. */
+    void on_connected()
+    {
+        m_AttMtu         = DEFAULT_ATT_MTU;
+        m_Subscribed     = false;
+        m_FlushPending   = false;
+        m_Sequence       = 0;
+        m_SampleCount    = 0;
+        m_DroppedSamples = 0;
+        m_Notifications  = 0;
+    }
+
+    /** Have hook called whenever a notification went out, i.e. right
+     *  after a connection event. */
+    void on_data_sent(mbed::Callback<void()> hook)
+    {
+        m_DataSentHook = hook;
+    }
+
+    /** Whether a client wants telemetry, i.e. samples are worth taking. */
+    bool wants_samples() const
+    {
+        return m_Subscribed;
+    }
+
+    /** Update the Battery Level characteristic, notifying a subscribed
+     *  client when it changed. */
+    ble_error_t set_battery_level(uint8_t level)
+    {
+        if (!m_Server || (level == m_BatteryLevel))
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        m_BatteryLevel = level;
+
+        return m_Server->write(m_BatteryLevelCharacteristic.getValueHandle(), &m_BatteryLevel, sizeof(m_BatteryLevel));
+    }
+
+    /** Append a sample of sample_size() bytes to the batch, notifying the
+     *  batch once it is full. */
+    ble_error_t push_sample(mbed::Span<const uint8_t> sample)
+    {
+        if (!m_Subscribed)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        if (m_FlushPending || (batch_capacity() == 0))
+        {
+            ++m_DroppedSamples;
+            return flush();
+        }
+
+        memcpy(&m_Batch[HEADER_SIZE + m_SampleCount * m_SampleSize], sample.data(), m_SampleSize);
+        ++m_SampleCount;
+
+        if (m_SampleCount < batch_capacity())
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        m_FlushPending = true;
+        return flush();
+    }
+
+    size_t sample_size() const
+    {
+        return m_SampleSize;
+    }
+
+    uint16_t att_mtu() const
+    {
+        return m_AttMtu;
+    }
+
+    uint32_t dropped_samples() const
+    {
+        return m_DroppedSamples;
+    }
+
+    uint32_t notifications() const
+    {
+        return m_Notifications;
+    }
+
+private:
+    static constexpr const char * TELEMETRY_SERVICE_UUID        = "a3c87500-8ed3-4bdf-8a39-a01bebede295";
+    static constexpr const char * TELEMETRY_CHARACTERISTIC_UUID = "a3c87501-8ed3-4bdf-8a39-a01bebede295";
+
+    /** Samples per notification at the current ATT_MTU. */
+    size_t batch_capacity() const
+    {
+        const size_t notificationSize = ((m_AttMtu - 3u) < MAX_NOTIFICATION_SIZE) ? (m_AttMtu - 3u) : MAX_NOTIFICATION_SIZE;
+        const size_t fitting          = (m_SampleSize > 0) ? (notificationSize - HEADER_SIZE) / m_SampleSize : 0;
+
+        return (fitting < MBED_CONF_APP_TELEMETRY_BATCH_SAMPLES) ? fitting : MBED_CONF_APP_TELEMETRY_BATCH_SAMPLES;
+    }
+
+    /** Notify the pending batch. It stays pending if the stack has no
+     *  room for it, to be retried from onDataSent(). */
+    ble_error_t flush()
+    {
+        if (!m_FlushPending)
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        m_Batch[0] = static_cast<uint8_t>(m_Sequence);
+        m_Batch[1] = static_cast<uint8_t>(m_Sequence >> 8);
+        m_Batch[2] = static_cast<uint8_t>(m_SampleCount);
+        m_Batch[3] = static_cast<uint8_t>(m_SampleSize);
+
+        ble_error_t error = m_Server->write(m_TelemetryCharacteristic.getValueHandle(),
+                                            m_Batch,
+                                            static_cast<uint16_t>(HEADER_SIZE + m_SampleCount * m_SampleSize));
+
+        if ((error == BLE_STACK_BUSY) || (error == BLE_ERROR_NO_MEM))
+        {
+            return BLE_ERROR_NONE;
+        }
+
+        // Anything else will not get better by trying again.
+        m_Sequence      = static_cast<uint16_t>(m_Sequence + m_SampleCount);
+        m_SampleCount   = 0;
+        m_FlushPending  = false;
+
+        if (!error)
+        {
+            ++m_Notifications;
+        }
+
+        return error;
+    }
+
+    void onUpdatesEnabled(const GattUpdatesEnabledCallbackParams &params) override
+    {
+        if (params.attHandle == m_TelemetryCharacteristic.getValueHandle())
+        {
+            m_Subscribed = true;
+        }
+    }
+
+    void onUpdatesDisabled(const GattUpdatesDisabledCallbackParams &params) override
+    {
+        if (params.attHandle == m_TelemetryCharacteristic.getValueHandle())
+        {
+            m_Subscribed   = false;
+            m_FlushPending = false;
+            m_SampleCount  = 0;
+        }
+    }
+
+    void onDataSent(const GattDataSentCallbackParams &) override
+    {
+        if (m_DataSentHook)
+        {
+            m_DataSentHook();
+        }
+
+        flush();
+    }
+
+    void onAttMtuChange(ble::connection_handle_t, uint16_t attMtuSize) override
+    {
+        // The batch under way only ever grows, since the MTU cannot shrink
+        // within a connection.
+        m_AttMtu = attMtuSize;
+    }
+
+    ble::GattServer *  m_Server;
+
+    // Values of the characteristics. The batch is assembled in place.
+    uint8_t            m_BatteryLevel;
+    uint8_t            m_Batch[MAX_NOTIFICATION_SIZE];
+    GattCharacteristic m_BatteryLevelCharacteristic;
+    GattCharacteristic m_TelemetryCharacteristic;
+
+    size_t             m_SampleSize;
+    uint16_t           m_AttMtu;
+    bool               m_Subscribed;
+    bool               m_FlushPending;
+    uint16_t           m_Sequence;
+    size_t             m_SampleCount;
+    uint32_t           m_DroppedSamples;
+    uint32_t           m_Notifications;
+
+    mbed::Callback<void()> m_DataSentHook;
+};
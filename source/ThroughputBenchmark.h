@@ -0,0 +1,229 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include "cmsis.h"
+#include "ble/BLE.h"
+
+// Bookkeeping for the payload throughput benchmark.
+//
+// The benchmark drives setAdvertisingPayload() at a fixed rate for a
+// while, then at twice that rate, and so on, until the shortest interval
+// is reached or the stack rejects most of the writes. ThroughputBenchmark
+// keeps what each of these steps achieved: writes attempted and accepted,
+// BLE_STACK_BUSY and other rejections, and how long the call took to
+// return. It also prints the summary table. It does no scheduling of its
+// own.
+//
+// Latencies are in microseconds and go into a histogram with four buckets
+// per power of two, so the percentiles are accurate to within 19%. The
+// latency is that of the call, i.e. of handing the HCI command to the
+// transport. Gap reports nothing when the controller completes the
+// command, so the back-pressure shows up as BLE_STACK_BUSY and as
+// calls that take longer, once the transport has filled up.
+class ThroughputBenchmark
+{
+public:
+    static constexpr size_t MAX_STEPS = 16;
+
+    ThroughputBenchmark(uint32_t startIntervalMs, uint32_t minimumIntervalMs)
+        : m_MinimumIntervalMs(minimumIntervalMs)
+        , m_StepCount(0)
+        , m_Current()
+        , m_Saturated(false)
+    {
+        m_Current.m_IntervalMs = startIntervalMs;
+    }
+
+    /** Interval of the step under way, or about to start. */
+    uint32_t interval_ms() const
+    {
+        return m_Current.m_IntervalMs;
+    }
+
+    void record(ble_error_t error, uint32_t latencyUs)
+    {
+        ++m_Current.m_Attempts;
+
+        if (!error)
+        {
+            ++m_Current.m_Committed;
+        }
+        else if (error == BLE_STACK_BUSY)
+        {
+            ++m_Current.m_StackBusy;
+        }
+        else
+        {
+            ++m_Current.m_OtherErrors;
+        }
+
+        if (latencyUs > m_Current.m_MaximumUs)
+        {
+            m_Current.m_MaximumUs = latencyUs;
+        }
+
+        ++m_Histogram[bucket(latencyUs)];
+    }
+
+    /** Close the step under way, which lasted elapsedMs, and set up the
+     *  next one. Returns false once the ramp is over. */
+    bool end_step(uint32_t elapsedMs)
+    {
+        m_Current.m_ElapsedMs = elapsedMs;
+        m_Current.m_P50Us     = percentile(50);
+        m_Current.m_P90Us     = percentile(90);
+        m_Current.m_P99Us     = percentile(99);
+
+        m_Steps[m_StepCount++] = m_Current;
+
+        // More than half of the writes bounced, going any faster only
+        // measures the stack's error path.
+        m_Saturated = (m_Current.m_StackBusy + m_Current.m_OtherErrors) * 2 > m_Current.m_Attempts;
+
+        const uint32_t nextIntervalMs = m_Current.m_IntervalMs / 2;
+
+        if (m_Saturated || (nextIntervalMs < m_MinimumIntervalMs) || (m_StepCount == MAX_STEPS))
+        {
+            return false;
+        }
+
+        m_Current              = Step_t();
+        m_Current.m_IntervalMs = nextIntervalMs;
+
+        for (uint32_t &count : m_Histogram)
+        {
+            count = 0;
+        }
+
+        return true;
+    }
+
+    void print_report() const
+    {
+        printf("Payload throughput (setAdvertisingPayload latency in us):\r\n");
+        printf("  %8s %8s %8s %8s %8s %8s %8s %8s %8s %8s\r\n",
+               "interval", "attempts", "ok", "busy", "failed", "ok/s", "p50", "p90", "p99", "max");
+
+        const Step_t *sustainable = nullptr;
+
+        for (size_t i = 0; i < m_StepCount; ++i)
+        {
+            const Step_t &step = m_Steps[i];
+
+            printf("  %6lums %8lu %8lu %8lu %8lu %8lu %8lu %8lu %8lu %8lu\r\n",
+                   static_cast<unsigned long>(step.m_IntervalMs),
+                   static_cast<unsigned long>(step.m_Attempts),
+                   static_cast<unsigned long>(step.m_Committed),
+                   static_cast<unsigned long>(step.m_StackBusy),
+                   static_cast<unsigned long>(step.m_OtherErrors),
+                   static_cast<unsigned long>(step.m_ElapsedMs ? 1000ULL * step.m_Committed / step.m_ElapsedMs : 0),
+                   static_cast<unsigned long>(step.m_P50Us),
+                   static_cast<unsigned long>(step.m_P90Us),
+                   static_cast<unsigned long>(step.m_P99Us),
+                   static_cast<unsigned long>(step.m_MaximumUs));
+
+            if ((step.m_Attempts > 0) && (step.m_Committed == step.m_Attempts))
+            {
+                sustainable = &step;
+            }
+        }
+
+        if (sustainable)
+        {
+            printf("Every write accepted down to %lu ms between updates%s\r\n",
+                   static_cast<unsigned long>(sustainable->m_IntervalMs),
+                   m_Saturated ? "" : ", the shortest interval tried");
+        }
+        else
+        {
+            printf("No step had every write accepted\r\n");
+        }
+    }
+
+private:
+    // Four buckets per power of two, 0 to 3 us each having one of their own.
+    static constexpr size_t HISTOGRAM_BUCKETS = 4 * 31;
+
+    struct Step_t
+    {
+        uint32_t m_IntervalMs  = 0;
+        uint32_t m_ElapsedMs   = 0;
+        uint32_t m_Attempts    = 0;
+        uint32_t m_Committed   = 0;
+        uint32_t m_StackBusy   = 0;
+        uint32_t m_OtherErrors = 0;
+        uint32_t m_P50Us       = 0;
+        uint32_t m_P90Us       = 0;
+        uint32_t m_P99Us       = 0;
+        uint32_t m_MaximumUs   = 0;
+    };
+
+    static size_t bucket(uint32_t latencyUs)
+    {
+        if (latencyUs < 4)
+        {
+            return latencyUs;
+        }
+
+        // The two bits below the leading one pick the quarter.
+        const uint32_t exponent = 31 - __CLZ(latencyUs);
+        const uint32_t quarter  = (latencyUs >> (exponent - 2)) & 0x3;
+
+        return 4 * (exponent - 1) + quarter;
+    }
+
+    /** Lower bound of the latencies in bucket index. */
+    static uint32_t bucket_floor(size_t index)
+    {
+        if (index < 4)
+        {
+            return index;
+        }
+
+        return static_cast<uint32_t>(4 + index % 4) << (index / 4 - 1);
+    }
+
+    uint32_t percentile(uint32_t percent) const
+    {
+        // Rank of the sample sought, rounded up.
+        const uint64_t rank = (static_cast<uint64_t>(m_Current.m_Attempts) * percent + 99) / 100;
+
+        uint64_t seen = 0;
+
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+        {
+            seen += m_Histogram[i];
+
+            if ((seen >= rank) && (seen > 0))
+            {
+                return bucket_floor(i);
+            }
+        }
+
+        return 0;
+    }
+
+    uint32_t m_MinimumIntervalMs;
+    Step_t   m_Steps[MAX_STEPS];
+    size_t   m_StepCount;
+    Step_t   m_Current;
+    uint32_t m_Histogram[HISTOGRAM_BUCKETS] = {};
+    bool     m_Saturated;
+};
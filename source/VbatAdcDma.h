@@ -0,0 +1,140 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2006-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "cmsis.h"
+#include "platform/mbed_wait_api.h"
+
+#if !defined(TARGET_STM32WB)
+#error "app.dma-sampling drives the STM32WB ADC and DMA, this target needs a driver of its own"
+#endif
+
+#include "stm32wbxx_ll_adc.h"
+#include "stm32wbxx_ll_bus.h"
+#include "stm32wbxx_ll_dma.h"
+#include "stm32wbxx_ll_dmamux.h"
+
+// Feeds a DoubleBufferedAdcSampler from the battery voltage, VBAT, of the
+// STM32WB, without the CPU ever starting or waiting for a conversion.
+//
+// ADC1 converts the internal VBAT channel continuously and DMA1 channel 1,
+// requested through the DMAMUX, moves each result into the sampler's
+// buffer in circular mode. The ADC oversamples by 256 in hardware, so that
+// even with the longest sample time, which the high impedance VBAT path
+// needs, results come at no more than some hundred per second, and the
+// DMA interrupts at the block rate only. The low level drivers are used
+// rather than the HAL, which would want the HAL_ADC_Conv*Callback
+// functions defined once for the whole program.
+//
+// Note that the ADC stops with the clocks in deep sleep and resumes on
+// waking, which suits a battery, and that it cannot be shared with
+// AnalogIn while the sampler runs.
+template <typename Sampler_t>
+class VbatAdcDma
+{
+public:
+    /** Configure ADC1 and DMA1 channel 1 for sampler and start them.
+     *  Blocks for the regulator to settle and the calibration, some tens of
+     *  microseconds, once. */
+    static void start(Sampler_t &sampler)
+    {
+        s_Sampler = &sampler;
+
+        LL_AHB2_GRP1_EnableClock(LL_AHB2_GRP1_PERIPH_ADC);
+        LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMAMUX1);
+        LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMA1);
+
+        LL_DMA_SetPeriphRequest(DMA1, LL_DMA_CHANNEL_1, LL_DMAMUX_REQ_ADC1);
+        LL_DMA_ConfigTransfer(DMA1, LL_DMA_CHANNEL_1,
+                              LL_DMA_DIRECTION_PERIPH_TO_MEMORY | LL_DMA_MODE_CIRCULAR
+                              | LL_DMA_PERIPH_NOINCREMENT | LL_DMA_MEMORY_INCREMENT
+                              | LL_DMA_PDATAALIGN_HALFWORD | LL_DMA_MDATAALIGN_HALFWORD
+                              | LL_DMA_PRIORITY_LOW);
+        LL_DMA_ConfigAddresses(DMA1, LL_DMA_CHANNEL_1,
+                               LL_ADC_DMA_GetRegAddr(ADC1, LL_ADC_DMA_REG_REGULAR_DATA),
+                               reinterpret_cast<uint32_t>(sampler.dma_buffer()),
+                               LL_DMA_DIRECTION_PERIPH_TO_MEMORY);
+        LL_DMA_SetDataLength(DMA1, LL_DMA_CHANNEL_1, Sampler_t::dma_length());
+        LL_DMA_EnableIT_HT(DMA1, LL_DMA_CHANNEL_1);
+        LL_DMA_EnableIT_TC(DMA1, LL_DMA_CHANNEL_1);
+
+        NVIC_SetVector(DMA1_Channel1_IRQn, reinterpret_cast<uint32_t>(&on_dma_interrupt));
+        NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+        LL_DMA_EnableChannel(DMA1, LL_DMA_CHANNEL_1);
+
+        LL_ADC_SetCommonClock(__LL_ADC_COMMON_INSTANCE(ADC1), LL_ADC_CLOCK_SYNC_PCLK_DIV4);
+        LL_ADC_SetCommonPathInternalCh(__LL_ADC_COMMON_INSTANCE(ADC1), LL_ADC_PATH_INTERNAL_VBAT);
+
+        LL_ADC_SetResolution(ADC1, LL_ADC_RESOLUTION_12B);
+        LL_ADC_SetOverSamplingScope(ADC1, LL_ADC_OVS_GRP_REGULAR_CONTINUED);
+        LL_ADC_ConfigOverSamplingRatioShift(ADC1, LL_ADC_OVS_RATIO_256, LL_ADC_OVS_SHIFT_RIGHT_8);
+        LL_ADC_REG_SetTriggerSource(ADC1, LL_ADC_REG_TRIG_SOFTWARE);
+        LL_ADC_REG_SetContinuousMode(ADC1, LL_ADC_REG_CONV_CONTINUOUS);
+        LL_ADC_REG_SetDMATransfer(ADC1, LL_ADC_REG_DMA_TRANSFER_UNLIMITED);
+        LL_ADC_REG_SetOverrun(ADC1, LL_ADC_REG_OVR_DATA_OVERWRITTEN);
+        LL_ADC_REG_SetSequencerRanks(ADC1, LL_ADC_REG_RANK_1, LL_ADC_CHANNEL_VBAT);
+        LL_ADC_SetChannelSamplingTime(ADC1, LL_ADC_CHANNEL_VBAT, LL_ADC_SAMPLINGTIME_640CYCLES_5);
+
+        LL_ADC_DisableDeepPowerDown(ADC1);
+        LL_ADC_EnableInternalRegulator(ADC1);
+        wait_us(LL_ADC_DELAY_INTERNAL_REGUL_STAB_US);
+
+        LL_ADC_StartCalibration(ADC1, LL_ADC_SINGLE_ENDED);
+        while (LL_ADC_IsCalibrationOnGoing(ADC1))
+        {
+        }
+
+        LL_ADC_Enable(ADC1);
+        while (!LL_ADC_IsActiveFlag_ADRDY(ADC1))
+        {
+        }
+
+        LL_ADC_REG_StartConversion(ADC1);
+    }
+
+    /** A sample in millivolts. The VBAT channel sees a third of the
+     *  battery voltage, relative to VDDA, which the Nucleo supplies at
+     *  3.3 V. */
+    static uint32_t to_millivolts(uint16_t sample)
+    {
+        return 3 * __LL_ADC_CALC_DATA_TO_VOLTAGE(VDDA_MILLIVOLTS, sample, LL_ADC_RESOLUTION_12B);
+    }
+
+private:
+    static constexpr uint32_t VDDA_MILLIVOLTS = 3300;
+
+    static void on_dma_interrupt()
+    {
+        if (LL_DMA_IsActiveFlag_HT1(DMA1))
+        {
+            LL_DMA_ClearFlag_HT1(DMA1);
+            s_Sampler->on_half_transfer();
+        }
+
+        if (LL_DMA_IsActiveFlag_TC1(DMA1))
+        {
+            LL_DMA_ClearFlag_TC1(DMA1);
+            s_Sampler->on_transfer_complete();
+        }
+    }
+
+    static Sampler_t *s_Sampler;
+};
+
+template <typename Sampler_t>
+Sampler_t *VbatAdcDma<Sampler_t>::s_Sampler = nullptr;
@@ -18,344 +18,254 @@
 #include "ble/BLE.h"
 #include "ble/Gap.h"
 
-// FYI, issue "mbed deploy" at either the top directory (../mbed-os-example-ble)
-// or the particular example directory to have all these peripherally
-// dependent files such as the below, be included in the project.
-#include "pretty_printer.h"
- 
 #include "mbed-trace/mbed_trace.h"
 
-// Needed for Nuertey Odzeyem's ErrorCodesMap_t implementation scheme below.
-#include <map>
-#include <string>
+#include "rtos/Kernel.h"
+#include "rtos/Thread.h"
+#include "platform/mbed_toolchain.h"
+#include "drivers/InterruptIn.h"
+#include "platform/mbed_power_mgmt.h"
+#include "platform/mbed_stats.h"
 
-const static char DEVICE_NAME[] = "NUCLEO-WB55RG";
+#include "BluetoothLowEnergyEncapsulation.h"
+#if MBED_CONF_APP_ZERO_HEAP_AFTER_INIT
+#include "HeapGuard.h"
+#endif
 
 using namespace std::literals::chrono_literals;
 
-using ErrorCodesMap_t = std::map<ble_error_t, std::string>;
-using IndexElement_t  = ErrorCodesMap_t::value_type;
+#if MBED_CONF_APP_LOW_POWER && (MBED_CONF_APP_LOW_POWER_REPORT_INTERVAL_MS > 0) && !MBED_CPU_STATS_ENABLED
+#error "app.low-power-report-interval-ms reads the CPU statistics and requires platform.cpu-stats-enabled"
+#endif
+
+#if MBED_CONF_APP_ZERO_HEAP_AFTER_INIT && !MBED_HEAP_STATS_ENABLED
+#error "app.zero-heap-after-init reads the heap statistics and requires platform.heap-stats-enabled"
+#endif
+
+// By default enough buffer space for 32 event Callbacks, i.e. 32*EVENT_QUEUE_EVENT_SIZE
+// Reduce this amount if the target device has severely limited RAM.
+//
+// The buffers of both queues are statically allocated, as is the
+// encapsulation in main(), so that none of the state of the advertising
+// loop lives on the heap.
+MBED_ALIGN(8) static unsigned char gs_SharedEventQueueBuffer[MBED_CONF_APP_SHARED_EVENT_QUEUE_SIZE * EVENT_QUEUE_EVENT_SIZE];
+
+static EventQueue_t g_SharedEventQueue(sizeof(gs_SharedEventQueueBuffer), gs_SharedEventQueueBuffer);
+
+#if MBED_CONF_APP_BLE_EVENT_THREAD
+// With app.ble-event-thread, BLE::processEvents and everything the
+// encapsulation does with the stack run from a queue of their own,
+// dispatched by a thread above the application's priority. A slow
+// application callback on g_SharedEventQueue, which main() keeps
+// dispatching at normal priority, can then no longer hold up the stack
+// or delay the controller's HCI events.
+MBED_ALIGN(8) static unsigned char gs_BleEventQueueBuffer[MBED_CONF_APP_BLE_EVENT_QUEUE_SIZE * EVENT_QUEUE_EVENT_SIZE];
+
+static EventQueue_t g_BleEventQueue(sizeof(gs_BleEventQueueBuffer), gs_BleEventQueueBuffer);
+
+MBED_ALIGN(8) static unsigned char gs_BleEventThreadStack[MBED_CONF_APP_BLE_EVENT_THREAD_STACK_SIZE];
+
+static rtos::Thread g_BleEventThread(MBED_CONF_APP_BLE_EVENT_THREAD_PRIORITY,
+                                     sizeof(gs_BleEventThreadStack),
+                                     gs_BleEventThreadStack,
+                                     "ble_events");
+#endif
+
+#if MBED_CONF_APP_CYCLE_PROFILING
+/* The profile is printed from the queue the measurements are taken on,
+ * so that printing it never races with them. */
+static void print_cycle_profile()
+{
+    CycleProfiler::instance().print_report();
+}
 
-inline static auto make_error_codes_map()
+static void request_cycle_profile()
 {
-    ErrorCodesMap_t eMap;
-
-    eMap.insert(IndexElement_t(BLE_ERROR_NONE, std::string("\"No error\"")));
-    eMap.insert(IndexElement_t(BLE_ERROR_BUFFER_OVERFLOW, std::string("\"The requested action would cause a buffer overflow and has been aborted\"")));
-    eMap.insert(IndexElement_t(BLE_ERROR_NOT_IMPLEMENTED, std::string("\"Requested a feature that isn't yet implemented or isn't supported by the target HW\"")));
-    eMap.insert(IndexElement_t(BLE_ERROR_PARAM_OUT_OF_RANGE, std::string("\"One of the supplied parameters is outside the valid range\"")));
-    eMap.insert(IndexElement_t(BLE_ERROR_INVALID_PARAM, std::string("\"One of the supplied parameters is invalid\"")));
-    eMap.insert(IndexElement_t(BLE_STACK_BUSY, std::string("\"The stack is busy\"")));
-    eMap.insert(IndexElement_t(BLE_ERROR_INVALID_STATE, std::string("\"Invalid state\"")));
-    eMap.insert(IndexElement_t(BLE_ERROR_NO_MEM, std::string("\"Out of memory\"")));
-    eMap.insert(IndexElement_t(BLE_ERROR_OPERATION_NOT_PERMITTED, std::string("\"The operation requested is not permitted\"")));
-    eMap.insert(IndexElement_t(BLE_ERROR_INITIALIZATION_INCOMPLETE, std::string("\"The BLE subsystem has not completed its initialization\"")));
-    eMap.insert(IndexElement_t(BLE_ERROR_ALREADY_INITIALIZED, std::string("\"The BLE system has already been initialized\"")));
-    eMap.insert(IndexElement_t(BLE_ERROR_UNSPECIFIED, std::string("\"Unknown error\"")));
-    eMap.insert(IndexElement_t(BLE_ERROR_INTERNAL_STACK_FAILURE, std::string("\"The platform-specific stack failed\"")));
-    eMap.insert(IndexElement_t(BLE_ERROR_NOT_FOUND, std::string("\"Data not found or there is nothing to return\"")));
-
-    return eMap;
+#if MBED_CONF_APP_BLE_EVENT_THREAD
+    g_BleEventQueue.call("cycle profile", print_cycle_profile);
+#else
+    g_SharedEventQueue.call("cycle profile", print_cycle_profile);
+#endif
 }
 
-static ErrorCodesMap_t gs_ErrorCodesMap = make_error_codes_map();
+#if defined(BUTTON1)
+// Pressing the user button dumps the profile on demand.
+static mbed::InterruptIn gs_CycleProfileButton(BUTTON1);
+#endif
+#endif
 
-inline std::string ToString(const ble_error_t & key)
+#if MBED_CONF_APP_LOW_POWER && (MBED_CONF_APP_LOW_POWER_REPORT_INTERVAL_MS > 0)
+/* Share of the time since the previous report spent running, idle but
+ * awake, in sleep and in deep sleep. */
+static void print_sleep_statistics()
 {
-    std::string result;
+    static mbed_stats_cpu_t previous = {};
 
-    // Prevent the possibility of std::out_of_range exception if the container
-    // does not have an error element with the specified key.
-    auto iter = gs_ErrorCodesMap.find(key);
-    if (iter != gs_ErrorCodesMap.end())
-    {
-        result = iter->second;
-    }
-    else
+    mbed_stats_cpu_t current;
+    mbed_stats_cpu_get(&current);
+
+    const us_timestamp_t uptime    = current.uptime - previous.uptime;
+    const us_timestamp_t sleep     = current.sleep_time - previous.sleep_time;
+    const us_timestamp_t deepSleep = current.deep_sleep_time - previous.deep_sleep_time;
+    const us_timestamp_t idle      = current.idle_time - previous.idle_time;
+
+    previous = current;
+
+    if (uptime == 0)
     {
-        result = std::string("\"Warning! Code does not indicate an error and consequently does not exist in gs_ErrorCodesMap!\"");
+        return;
     }
 
-    return result;
+    // Idle time includes the time asleep, in either state.
+    const us_timestamp_t awakeIdle = (idle > sleep + deepSleep) ? idle - sleep - deepSleep : 0;
+    const us_timestamp_t active    = (uptime > idle) ? uptime - idle : 0;
+
+    // Two lines, a deferred log entry taking four arguments at most.
+    LOG_PRINTF("Power: over %lu ms active %lu%%, idle %lu%%\r\n",
+               static_cast<unsigned long>(uptime / 1000),
+               static_cast<unsigned long>(active * 100 / uptime),
+               static_cast<unsigned long>(awakeIdle * 100 / uptime));
+    LOG_PRINTF("Power: sleep %lu%%, deep sleep %lu%%%s\r\n",
+               static_cast<unsigned long>(sleep * 100 / uptime),
+               static_cast<unsigned long>(deepSleep * 100 / uptime),
+               sleep_manager_can_deep_sleep() ? "" : " (deep sleep currently locked)");
 }
+#endif
 
-// By default enough buffer space for 32 event Callbacks, i.e. 32*EVENTS_EVENT_SIZE
-// Reduce this amount if the target device has severely limited RAM.
-static events::EventQueue g_SharedEventQueue(16 * EVENTS_EVENT_SIZE);
+// Called after every round of BLE event processing, so that the
+// encapsulation can retry a payload write the stack was too busy for.
+static mbed::Callback<void()> gs_OnBleEventsProcessed;
 
-// GAP
-//
-// GAP is an acronym for the Generic Access Profile, and it controls 
-// connections and advertising in Bluetooth. GAP is what makes your device
-// visible to the outside world, and determines how two devices can (or can't)
-// interact with each other.
-class BluetoothLowEnergyEncapsulation : ble::Gap::EventHandler
+static void process_ble_events(BLE &ble)
 {
-public:
-    BluetoothLowEnergyEncapsulation(BLE &ble, events::EventQueue &event_queue) 
-        : m_BluetoothLowEnergyStack(ble)
-        , m_SharedEventQueue(event_queue)
-        , m_TheBatteryLevel(50)
-        // Deliberately omitting m_AdvertisingBuffer here so that the implicit
-        // zero-initialization specified during declaration can kick in here.
-        , m_AdvertisingDataBuilder(m_AdvertisingBuffer, ble::LEGACY_ADVERTISING_MAX_SIZE)
+    ble.processEvents();
+
+    if (gs_OnBleEventsProcessed)
     {
+        gs_OnBleEventsProcessed();
     }
 
-    void start()
-    {
-        /* mbed will call on_init_complete when when ble is ready */
-        m_BluetoothLowEnergyStack.init(this, &BluetoothLowEnergyEncapsulation::on_init_complete);
+#if MBED_CONF_APP_ZERO_HEAP_AFTER_INIT
+    HeapGuard::check("BLE event processing");
+#endif
 
-        /* this will never return */
-        m_SharedEventQueue.dispatch_forever();
-    }
+#if MBED_CONF_APP_LOW_POWER
+    /* The stack only asks for processing while HCI traffic is in flight,
+     * which the transport may need clocks for that stop in deep sleep. Deep
+     * sleep is therefore held off from the request until processEvents()
+     * has run, and allowed at all other times. */
+    sleep_manager_unlock_deep_sleep();
+#endif
+}
 
-private:
-    /** Callback triggered when the ble initialization process has finished */
-    void on_init_complete(BLE::InitializationCompleteCallbackContext *params)
-    {
-        if (params->error != BLE_ERROR_NONE)
-        {
-            printf("Error! BLE initialization failed: \
-                [%d] -> %s\r\n", params->error, ToString(params->error).c_str());
-            //print_error(params->error, "Ble initialization failed.");
-            return;
-        }
+/* Schedule processing of events from the BLE middleware in the global shared event queue,
+ * or in the dedicated BLE event queue when the stack has a thread of its own. */
+void schedule_ble_events(BLE::OnEventsToProcessCallbackContext *context)
+{
+#if MBED_CONF_APP_BLE_EVENT_THREAD
+    EventQueue_t &queue = g_BleEventQueue;
+#else
+    EventQueue_t &queue = g_SharedEventQueue;
+#endif
 
-        print_mac_address();
+    BLE &ble = context->ble;
 
-        start_advertising();
-    }
+#if MBED_CONF_APP_LOW_POWER
+    sleep_manager_lock_deep_sleep();
 
-    void start_advertising()
+    if (!queue.call("ble events", [&ble]() { process_ble_events(ble); }))
     {
-        // Advertising and Scan Response Data
-        //
-        // There are two ways to send advertising out with GAP. 
-        // The Advertising Data payload and the Scan Response payload.
-        //
-        // Both payloads are identical and can contain up to 31 bytes of
-        // data, but only the advertising data payload is mandatory, since
-        // this is the payload that will be constantly transmitted out 
-        // from the device to let central devices in range know that it 
-        // exists. The scan response payload is an optional secondary 
-        // payload that central devices can request, and allows device 
-        // designers to fit a bit more information in the advertising
-        // payload such a strings for a device name, etc.
-        
-        /* create advertising parameters and payload */
-        ble::AdvertisingParameters advertisingParameters(
-            /* you cannot connect to this device, you can only read its advertising data,
-             * scannable means that the device has extra advertising data that the peer can receive if it
-             * "scans" it which means it is using active scanning (it sends a scan request) */
-            ble::advertising_type_t::SCANNABLE_UNDIRECTED,
-            ble::adv_interval_t(ble::millisecond_t(1000))
-        );
-
-        /* when advertising you can optionally add extra data that is only sent
-         * if the central requests it by doing active scanning (sending scan requests),
-         * in this example we set this payload first because we want to later reuse
-         * the same m_AdvertisingDataBuilder builder for payload updates */
-        const uint8_t _vendor_specific_data[4] = { 0xAD, 0xDE, 0xBE, 0xEF };
-        m_AdvertisingDataBuilder.setManufacturerSpecificData(_vendor_specific_data);
-
-        m_BluetoothLowEnergyStack.gap().setAdvertisingScanResponse(
-            ble::LEGACY_ADVERTISING_HANDLE,
-            m_AdvertisingDataBuilder.getAdvertisingData()
-        );
-
-        /* now we set the advertising payload that gets sent during 
-         * advertising without any scan requests */
-        m_AdvertisingDataBuilder.clear();
-        m_AdvertisingDataBuilder.setFlags();
-        m_AdvertisingDataBuilder.setName(DEVICE_NAME);
-
-        /* we add the battery level as part of the payload so it's visible
-         * to any device that scans, this part of the payload will be 
-         * updated periodically without affecting the rest of the payload */
-        m_AdvertisingDataBuilder.setServiceData(GattService::UUID_BATTERY_SERVICE, 
-                                                {&m_TheBatteryLevel, 1});
-
-        /* setup advertising */
-        ble_error_t error = m_BluetoothLowEnergyStack.gap().setAdvertisingParameters(
-                                ble::LEGACY_ADVERTISING_HANDLE,
-                                advertisingParameters
-                            );
-
-        if (error)
-        {
-            printf("Error! _ble.gap().setAdvertisingParameters() failed: \
-                [%d] -> %s\r\n", error, ToString(error).c_str());
-            //print_error(error, "_ble.gap().setAdvertisingParameters() failed");
-            return;
-        }
-
-        error = m_BluetoothLowEnergyStack.gap().setAdvertisingPayload(
-                    ble::LEGACY_ADVERTISING_HANDLE,
-                    m_AdvertisingDataBuilder.getAdvertisingData()
-                );
-
-        if (error)
-        {
-            printf("Error! _ble.gap().setAdvertisingPayload() failed: \
-                [%d] -> %s\r\n", error, ToString(error).c_str());
-            //print_error(error, "_ble.gap().setAdvertisingPayload() failed");
-            return;
-        }
-
-        /* start advertising */
-        error = m_BluetoothLowEnergyStack.gap().startAdvertising(ble::LEGACY_ADVERTISING_HANDLE);
-
-        if (error)
-        {
-            printf("Error! _ble.gap().startAdvertising() failed: \
-                [%d] -> %s\r\n", error, ToString(error).c_str());
-            //print_error(error, "_ble.gap().startAdvertising() failed");
-            return;
-        }
-
-        // Nuertey Odzeyem Note:
-        //
-        // Here, note that the EventQueue is not intrinsic nor necessary
-        // for the operation of the BLE Advertisement Service. Advertisements
-        // will always be ongoing, continuously. The EventQueue just helps
-        // us simulate a battery charging and discharging so that its value
-        // when changed can then be written into those continuous BLE
-        // advertisements. Separation of the application business logic
-        // and the BLE feature so to speak. To further clarify, the execution
-        // context needed to schedule BLE events/callbacks, could have
-        // been supplied by a thread.
-
-        /* we simulate battery discharging by updating it every second */
-        m_SharedEventQueue.call_every(1000ms, [this]()
-                                              {
-                                                  update_battery_level();
-                                              }
-        );
+        sleep_manager_unlock_deep_sleep();
     }
+#else
+    queue.call("ble events", [&ble]() { process_ble_events(ble); });
+#endif
+}
 
-    void update_battery_level()
+#if MBED_CONF_APP_BOOT_TIME_REPORT
+// Milestones of the previous boot, taken before this boot overwrites them.
+static uint32_t gs_PreviousBootTimes[BootTimeRecord::MILESTONE_COUNT];
+static bool     gs_PreviousBootTimesValid = false;
+#endif
+
+static void print_banner()
+{
+    LOG_PRINTF("\r\n\r\n\"../mbed-os-example-ble/BLE_Advertising\" Application - Beginning... \r\n\r\n");
+#ifdef MBED_MAJOR_VERSION
+    LOG_PRINTF("Mbed OS version: %d.%d.%d\n\n", MBED_MAJOR_VERSION, MBED_MINOR_VERSION, MBED_PATCH_VERSION);
+#endif
+    LOG_PRINTF("Built: %s, %s\n\n", __DATE__, __TIME__);
+
+#if MBED_CONF_APP_BOOT_TIME_REPORT
+    if (gs_PreviousBootTimesValid)
     {
-        if (m_TheBatteryLevel-- == 10)
-        {
-            m_TheBatteryLevel = 100;
-        }
-
-        // GATT
-        //
-        // GATT is an acronym for the Generic ATTribute Profile, and it defines
-        // the way that two Bluetooth Low Energy devices transfer data back and
-        // forth using concepts called Services and Characteristics. It makes use
-        // of a generic data protocol called the Attribute Protocol (ATT), which
-        // is used to store Services, Characteristics and related data in a
-        // simple lookup table using 16-bit IDs for each entry in the table.
-        // GATT comes into play once a dedicated connection is established between
-        // two devices, meaning that you have already gone through the advertising
-        // process governed by GAP.    
-        
-        // GATT Transactions
-        //
-        // An important concept to understand with GATT is the server/client relationship.
-        // The peripheral is known as the GATT Server, which holds the ATT lookup data and
-        // service and characteristic definitions, and the GATT Client (the phone/tablet), 
-        // which sends requests to this server.
-        // All transactions are started by the main device, the GATT Client, which receives
-        // response from the secondary device, the GATT Server.
-
-        // Broadcast Network Topology
-        //
-        // While most peripherals advertise themselves so that a connection can be established
-        // and GATT services and characteristics can be used (which allows for much more data
-        // to be exchanged and in both directions), there are situations where you only want to
-        // advertise data.
-        //
-        // The main use case here is where you want a peripheral to send data to more than
-        // one device at a time. This is only possible using the advertising packet since data
-        // sent and received in connected mode can only be seen by those two connected
-        // devices.
-        //
-        // By including a small amount of custom data in the 31 byte advertising or scan
-        // response payloads, you can use a low cost Bluetooth Low Energy peripheral to sent
-        // data one-way to any devices in listening range, as shown in the illustration below.
-        // This is known as Broadcasting in Bluetooth Low Energy.
-        //
-        // This is the approach use by Apple's iBeacon, for example, which inserts a custom
-        // payload in the main advertising packet, using the Manufacturer Specific Data field.
-        // 
-        // Once you establish a connection between your peripheral and a central device, the
-        // advertising process will generally stop and you will typically no longer be able to send
-        // advertising packets out anymore, and you will use GATT services and characteristics
-        // to communicate in both directions.
-
-        /* update the payload with the new value of the bettery level, 
-         * the rest of the payload remains the same */
-        ble_error_t error = m_AdvertisingDataBuilder.setServiceData(
-                                      GattService::UUID_BATTERY_SERVICE, 
-                                      make_Span(&m_TheBatteryLevel, 1));
-
-        if (error)
-        {
-            printf("Error! _adv_data_builder.setServiceData() failed: \
-                [%d] -> %s\r\n", error, ToString(error).c_str());
-            //print_error(error, "_adv_data_builder.setServiceData() failed");
-            return;
-        }
-
-        /* set the new payload, we don't need to stop advertising */
-        error = m_BluetoothLowEnergyStack.gap().setAdvertisingPayload(
-                    ble::LEGACY_ADVERTISING_HANDLE,
-                    m_AdvertisingDataBuilder.getAdvertisingData()
-                );
-
-        if (error)
-        {
-            printf("Error! _ble.gap().setAdvertisingPayload() failed: \
-                [%d] -> %s\r\n", error, ToString(error).c_str());
-            //print_error(error, "_ble.gap().setAdvertisingPayload() failed");
-            return;
-        }
+        LOG_PRINTF("Previous boot: main() at %lu ms, BLE initialized at %lu ms, advertising at %lu ms\r\n",
+                   static_cast<unsigned long>(gs_PreviousBootTimes[BootTimeRecord::MAIN_ENTERED]),
+                   static_cast<unsigned long>(gs_PreviousBootTimes[BootTimeRecord::BLE_INITIALIZED]),
+                   static_cast<unsigned long>(gs_PreviousBootTimes[BootTimeRecord::ADVERTISING_STARTED]));
     }
+#endif
+}
 
-private:
-    // The Cordio Bluetooth stack only stores one single signing key. This key is then 
-    // shared across all bonded devices. If a malicious device bonds with the Mbed OS 
-    // application it then gains knowledge of the shared signing key of the Mbed OS device. 
-    // The malicious device can then track the Mbed OS device whenever a signing write 
-    // is issued from it. 
-    // 
-    // To overcome this privacy issue do not issue signed writes from the Mbed OS device.
-    // A signed write occurs when the member function `write` of `GattClient` is called 
-    // with its `cmd` argument set to `GATT_OP_SIGNED_WRITE_CMD`.
-    // 
-    // Instead of using signed writes, enable encryption on the connection. This is achieved
-    // by calling the function `setLinkEncryption` of the `SecurityManager`. Set the encryption 
-    // to at least `ENCRYPTED`. 
-    BLE &                       m_BluetoothLowEnergyStack;
-    
-    events::EventQueue &        m_SharedEventQueue;
-    uint8_t                     m_TheBatteryLevel; // The data to be broadcasted in the BLE advertisements.
-    
-    // Leverage C++11 member initializers to guarantee that the buffer 
-    // is zeroed out upon construction before passing it on to the DataBuilder.
-    uint8_t                     m_AdvertisingBuffer[ble::LEGACY_ADVERTISING_MAX_SIZE] = {};
-    ble::AdvertisingDataBuilder m_AdvertisingDataBuilder;
-};
-
-/* Schedule processing of events from the BLE middleware in the global shared event queue. */
-void schedule_ble_events(BLE::OnEventsToProcessCallbackContext *context)
+#if MBED_CONF_APP_FAST_BOOT
+/* The part of start up that advertising does not depend on, run once the
+ * first advertisement is out. */
+static void complete_boot()
+{
+    print_banner();
+    mbed_trace_init();
+}
+#endif
+
+#if MBED_CONF_APP_ZERO_HEAP_AFTER_INIT
+static void arm_heap_guard()
+{
+#if MBED_CONF_APP_BLE_EVENT_THREAD
+    EventQueue_t &queue = g_BleEventQueue;
+#else
+    EventQueue_t &queue = g_SharedEventQueue;
+#endif
+
+    /* posted to the queue the encapsulation runs on, so that the rest of
+     * the start up of advertising, in whose middle this is, comes first */
+    queue.call("heap guard", HeapGuard::arm);
+}
+#endif
+
+/* Run once the first advertisement is out. */
+static void on_first_advertisement()
 {
-    g_SharedEventQueue.call(Callback<void()>(&context->ble, &BLE::processEvents));
+#if MBED_CONF_APP_FAST_BOOT
+    complete_boot();
+#endif
+
+#if MBED_CONF_APP_ZERO_HEAP_AFTER_INIT
+    arm_heap_guard();
+#endif
 }
 
 int main()
 {
-    printf("\r\n\r\n\"../mbed-os-example-ble/BLE_Advertising\" Application - Beginning... \r\n\r\n");
-#ifdef MBED_MAJOR_VERSION
-    printf("Mbed OS version: %d.%d.%d\n\n", MBED_MAJOR_VERSION, MBED_MINOR_VERSION, MBED_PATCH_VERSION);
+#if MBED_CONF_APP_BOOT_TIME_REPORT
+    BootTimeRecord::mark(BootTimeRecord::MAIN_ENTERED);
+    gs_PreviousBootTimesValid = BootTimeRecord::take_previous(gs_PreviousBootTimes);
 #endif
-    printf("Built: %s, %s\n\n", __DATE__, __TIME__);
+
+#if MBED_CONF_APP_ZERO_HEAP_AFTER_INIT
+    /* stdout would otherwise get its buffer from the heap on the first
+     * write, which may well come after start up, from DeferredLog */
+    static char stdoutBuffer[BUFSIZ];
+    setvbuf(stdout, stdoutBuffer, _IOLBF, sizeof(stdoutBuffer));
+#endif
+
+#if MBED_CONF_APP_DEFERRED_LOG
+    DeferredLog::instance().start();
+#endif
+
+#if !MBED_CONF_APP_FAST_BOOT
+    print_banner();
     mbed_trace_init();
+#endif
 
     // "Got to a point where i am confident how to use a single service 
     // that comes with Mbed OS or i also can create a simple custom service…
@@ -373,13 +283,66 @@ int main()
     // instantiate two (different ones) of them."
     //
     // https://forums.mbed.com/t/ble-proper-way-to-add-several-services/13628
+#if MBED_CONF_APP_CYCLE_PROFILING
+    CycleProfiler::instance().enable();
+#if defined(BUTTON1)
+    gs_CycleProfileButton.fall(request_cycle_profile);
+#endif
+    if (MBED_CONF_APP_CYCLE_PROFILING_REPORT_INTERVAL_MS > 0)
+    {
+        g_SharedEventQueue.call_every("cycle profile request", std::chrono::milliseconds(MBED_CONF_APP_CYCLE_PROFILING_REPORT_INTERVAL_MS),
+                                      request_cycle_profile);
+    }
+#endif
+
     BLE &ble = BLE::Instance(); // Singleton
     ble.onEventsToProcess(schedule_ble_events);
 
-    BluetoothLowEnergyEncapsulation demo(ble, g_SharedEventQueue);
+#if MBED_CONF_APP_BLE_EVENT_THREAD
+    g_BleEventThread.start(callback(&g_BleEventQueue, &events::EventQueue::dispatch_forever));
+
+    // The encapsulation only ever talks to the stack, so it lives entirely
+    // on the BLE thread; initializing from there too keeps every BLE API
+    // call on one thread.
+    static BluetoothLowEnergyEncapsulation demo(ble, g_BleEventQueue);
+    gs_OnBleEventsProcessed = callback(&demo, &BluetoothLowEnergyEncapsulation::on_ble_events_processed);
+    demo.on_first_advertisement(on_first_advertisement);
+    g_BleEventQueue.call("start", callback(&demo, &BluetoothLowEnergyEncapsulation::start));
+#else
+    static BluetoothLowEnergyEncapsulation demo(ble, g_SharedEventQueue);
+    gs_OnBleEventsProcessed = callback(&demo, &BluetoothLowEnergyEncapsulation::on_ble_events_processed);
+    demo.on_first_advertisement(on_first_advertisement);
     demo.start();
+#endif
+
+#if MBED_CONF_APP_EVENT_QUEUE_INSTRUMENTATION
+    g_SharedEventQueue.call_every("queue statistics", std::chrono::milliseconds(MBED_CONF_APP_EVENT_QUEUE_REPORT_INTERVAL_MS), []()
+                                  {
+                                      g_SharedEventQueue.print_statistics("shared");
+#if MBED_CONF_APP_BLE_EVENT_THREAD
+                                      g_BleEventQueue.print_statistics("ble");
+#endif
+                                  }
+    );
+#endif
+
+#if MBED_CONF_APP_LOW_POWER && (MBED_CONF_APP_LOW_POWER_REPORT_INTERVAL_MS > 0)
+    g_SharedEventQueue.call_every("sleep statistics", std::chrono::milliseconds(MBED_CONF_APP_LOW_POWER_REPORT_INTERVAL_MS),
+                                  print_sleep_statistics);
+#endif
+
+#if MBED_CONF_APP_ZERO_HEAP_AFTER_INIT
+    g_SharedEventQueue.call_every("heap check", std::chrono::milliseconds(MBED_CONF_APP_HEAP_CHECK_INTERVAL_MS), []()
+                                  {
+                                      HeapGuard::check("the shared event queue");
+                                  }
+    );
+#endif
+
+    /* this will never return, application callbacks are dispatched here */
+    g_SharedEventQueue.dispatch_forever();
 
     // As per design, we will NEVER get to this statement. Great! Helps with debug...
-    printf("\r\n\r\n\"../mbed-os-example-ble/BLE_Advertising\" - Exiting.\r\n\r\n");
+    LOG_PRINTF("\r\n\r\n\"../mbed-os-example-ble/BLE_Advertising\" - Exiting.\r\n\r\n");
     return 0;
 }